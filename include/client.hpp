@@ -2,10 +2,13 @@
 #define BALATROGETHER_CLIENT_H
 
 #include <arpa/inet.h>
+#include <atomic>
+#include <mutex>
 #include "types.hpp"
 #include "util/ssl.hpp"
 #include "util/logs.hpp"
 #include "util/misc.hpp"
+#include "util/buffer.hpp"
 
 namespace balatrogether {
   class Client {
@@ -22,13 +25,31 @@ namespace balatrogether {
       void setPlayer(player_t player);
       lobby_t getLobby();
       void setLobby(lobby_t lobby);
+      bool isClosed();
+      void close();
+      void ref();
+      void unref();
+
+      size_t getQueuedMessages();
+      size_t getQueuedBytes();
+      long getStallTime();
+      uint64_t getDroppedMessages();
     private:
       friend class Player;
+      friend class NetworkManager;
+      friend class UringReactor;
       int fd;
       struct sockaddr_in addr;
       player_t player = nullptr;
-      lobby_t lobby = nullptr;
+      std::atomic<lobby_t> lobby;
       SSL *ssl = nullptr;
+      std::mutex io;
+      ReadBuffer inbox;
+      WriteQueue outbox;
+      bool readBlocked = false;
+      bool writeBlocked = false;
+      std::atomic<bool> closed;
+      std::atomic<int> refs;
   };
 }
 
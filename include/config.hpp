@@ -1,10 +1,11 @@
 #ifndef BALATROGETHER_CONFIG_H
 #define BALATROGETHER_CONFIG_H
 
+#include <unordered_set>
 #include "types.hpp"
 
 namespace balatrogether {
-  typedef std::vector<steamid_t> steamid_list_t;
+  typedef std::unordered_set<steamid_t> steamid_set_t;
 
   class Config {
     public:
@@ -13,6 +14,11 @@ namespace balatrogether {
 
       int getMaxPlayers();
       int getMaxLobbies();
+      int getIOThreads();
+      string getIOBackend();
+      size_t getSendHighWater();
+      int getLobbyWorkers();
+      int getLobbyStealThreshold();
       bool isTLSEnabled();
       bool isDebugMode();
       void setWhitelistEnabled(bool whitelistEnabled);
@@ -27,17 +33,35 @@ namespace balatrogether {
 
       bool isSteamApiEnabled();
       string getSteamApiKey();
+      string getSteamApiUrl();
+      int getSteamApiWorkers();
+      size_t getNameCacheSize();
+      int getNameCacheTTL();
     private:
+      static void load(json& list, const char *name, steamid_set_t& ids, json& entries);
+      static void remove(json& entries, steamid_t steamId);
       void save();
+      json saved;
       int maxPlayers = 8;
       int maxLobbies = 1;
+      int ioThreads = 2;
+      string ioBackend = "epoll";
+      size_t sendHighWater = 1048576;
+      int lobbyWorkers = 2;
+      int lobbyStealThreshold = 2;
       bool tlsEnabled = true;
-      steamid_list_t banned;
+      steamid_set_t banned;
+      json bannedList = json::array();
       bool debugMode = DEBUG;
       bool whitelistEnabled = false;
-      steamid_list_t whitelisted;
+      steamid_set_t whitelisted;
+      json whitelistedList = json::array();
       bool steamApiEnabled = false;
       string steamApiKey;
+      string steamApiUrl = "http://api.steampowered.com";
+      int steamApiWorkers = 2;
+      size_t nameCacheSize = 10000;
+      int nameCacheTTL = 3600;
   };
 };
 
@@ -12,7 +12,7 @@ namespace balatrogether {
       string getDescription();
       int getOptionalParameterCount();
       string getUsage();
-      virtual void execute(server_t server, client_t client, json args) {};
+      virtual void execute(server_t server, client_t client, json& args) {};
     private:
       std::vector<string> params;
       int num_optional;
@@ -22,49 +22,61 @@ namespace balatrogether {
   class HelpCommand : public ConsoleEvent {
     public:
       HelpCommand() : ConsoleEvent("help", {}, "Displays this list of commands") {};
-      void execute(server_t server, client_t client, json args);
+      void execute(server_t server, client_t client, json& args);
   };
 
   class PlayerListCommand : public ConsoleEvent {
     public:
       PlayerListCommand() : ConsoleEvent("list", {"lobby"}, "Display a list of all connected players", 1) {};
-      void execute(server_t server, client_t client, json args);
+      void execute(server_t server, client_t client, json& args);
   };
 
   class StopCommand : public ConsoleEvent {
     public:
       StopCommand() : ConsoleEvent("stop", {"lobby"}, "Immediately shutdown the server/lobby", 1) {};
-      void execute(server_t server, client_t client, json args);
+      void execute(server_t server, client_t client, json& args);
   };
 
   class LobbyListCommand : public ConsoleEvent {
     public:
       LobbyListCommand() : ConsoleEvent("lobbies", {"page"}, "List information about the server's lobbies", 1) {};
-      void execute(server_t server, client_t client, json args);
+      void execute(server_t server, client_t client, json& args);
   };
 
   class KickCommand : public ConsoleEvent {
     public:
       KickCommand() : ConsoleEvent("kick", {"id"}, "Disconnects a player from the server by their Steam ID") {};
-      void execute(server_t server, client_t client, json args);
+      void execute(server_t server, client_t client, json& args);
   };
 
   class BanCommand : public ConsoleEvent {
     public:
       BanCommand() : ConsoleEvent("ban", {"id"}, "Disconnects a player and bans by their Steam ID") {};
-      void execute(server_t server, client_t client, json args);
+      void execute(server_t server, client_t client, json& args);
   };
 
   class UnbanCommand : public ConsoleEvent {
     public:
       UnbanCommand() : ConsoleEvent("unban", {"id"}, "Remove a Steam ID from the ban list") {};
-      void execute(server_t server, client_t client, json args);
+      void execute(server_t server, client_t client, json& args);
   };
 
   class WhitelistCommand : public ConsoleEvent {
     public:
       WhitelistCommand() : ConsoleEvent("whitelist", {"on/off/add/remove", "id"}, "Manages the server whitelist", 1) {};
-      void execute(server_t server, client_t client, json args);
+      void execute(server_t server, client_t client, json& args);
+  };
+
+  class NetStatsCommand : public ConsoleEvent {
+    public:
+      NetStatsCommand() : ConsoleEvent("netstats", {}, "Display the outgoing queue of each connected client") {};
+      void execute(server_t server, client_t client, json& args);
+  };
+
+  class RequestStatsCommand : public ConsoleEvent {
+    public:
+      RequestStatsCommand() : ConsoleEvent("requests", {}, "Display counts and latencies of persistent requests") {};
+      void execute(server_t server, client_t client, json& args);
   };
 }
 
@@ -10,21 +10,21 @@ namespace balatrogether {
   class JoinEvent : public Event<server_t> {
     public:
       JoinEvent() : Event("JOIN") {};
-      virtual void execute(server_t server, client_t client, json req);
+      virtual void execute(server_t server, client_t client, json& req);
   };
 
   // Triggered when a player wants to join a lobby
   class JoinLobbyEvent : public Event<server_t> {
     public:
       JoinLobbyEvent() : Event("JOIN_LOBBY") {};
-      virtual void execute(server_t server, client_t client, json req);
+      virtual void execute(server_t server, client_t client, json& req);
   };
 
   // Triggered when the lobby host wants to start a run
   class StartRunEvent : public Event<lobby_t> {
     public:
       StartRunEvent() : Event("START") {};
-      virtual void execute(lobby_t lobby, client_t client, json req);
+      virtual void execute(lobby_t lobby, client_t client, json& req);
   };
 }
 
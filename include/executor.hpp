@@ -0,0 +1,53 @@
+#ifndef BALATROGETHER_EXECUTOR_H
+#define BALATROGETHER_EXECUTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include "types.hpp"
+
+#define EXECUTOR_BATCH 64
+
+namespace balatrogether {
+  // Pool of workers that run lobby events. Each lobby is owned by one worker at a time and runs its queued requests
+  // in order on it. A worker with nothing to do may take whole lobbies from a worker that has fallen behind. Lobbies
+  // waiting on a deadline are kept in a timer queue, and idle workers sleep until the earliest one is due
+  class LobbyExecutor {
+    public:
+      LobbyExecutor(int threads, int stealThreshold);
+      ~LobbyExecutor();
+
+      void assign(lobby_t lobby);
+      void submit(lobby_t lobby, client_t client, json req);
+      void wake(lobby_t lobby, std::chrono::steady_clock::time_point when);
+      void stop();
+    private:
+      struct worker {
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<lobby_t> queue;
+        std::thread thread;
+      };
+
+      void schedule(lobby_t lobby);
+      void fire(std::chrono::steady_clock::time_point& next);
+      lobby_t take(int index);
+      lobby_t steal(int index);
+      void loop(int index);
+
+      typedef std::pair<std::chrono::steady_clock::time_point, lobby_t> timer;
+
+      std::vector<worker*> workers;
+      std::mutex timerMutex;
+      std::priority_queue<timer, std::vector<timer>, std::greater<timer>> timers;
+      std::atomic<size_t> next;
+      std::atomic<bool> running;
+      int stealThreshold;
+  };
+}
+
+#endif
@@ -1,7 +1,8 @@
 #ifndef BALATROGETHER_GAME_H
 #define BALATROGETHER_GAME_H
 
-#include <unordered_set>
+#include <random>
+#include <vector>
 #include "types.hpp"
 #include "player.hpp"
 
@@ -14,9 +15,11 @@ namespace balatrogether {
     WAITING_FOR_LEADERBOARD,
   };
 
+  // State of the run a lobby is playing. Each player in the run is given a slot at start, and per-player state is
+  // kept in slot-indexed arrays with running counts, so checks against every remaining player are O(1). The
+  // version changes whenever the state sent to clients does, and that state is only serialized once per version.
+  // Random picks for the lobby come from the game's own generator, which is only used under the lobby lock
   class Game {
-    typedef std::pair<player_t, double> score_t;
-    typedef std::vector<score_t> leaderboard_t;
     public:
       Game();
 
@@ -27,14 +30,21 @@ namespace balatrogether {
       void start(player_list_t players, bool versus);
 
       player_list_t getPlayers();
+      size_t getPlayerCount();
+      int getSlot(player_t p);
+      player_t getPlayer(int slot);
       player_list_t getRemaining();
       player_list_t getEliminated();
+      size_t getRemainingCount();
+      size_t getEliminatedCount();
       player_t getRandomPlayer();
       player_t getRandomPlayer(player_t exclude);
+      std::mt19937& getRandom();
 
       game_state_t getState();
       void setState(game_state_t state);
       bool isEliminated(player_t p);
+      bool isSlotEliminated(int slot);
       void eliminate(player_t p);
       bool isBossReady();
       void prepareForBoss(player_t p);
@@ -42,14 +52,27 @@ namespace balatrogether {
       json getLeaderboard();
       void addScore(player_t p, double score);
 
-      json getJSON();
+      uint64_t getVersion();
+      const json& getJSON();
     private:
+      void changed();
+
       game_state_t state;
       bool versus;
       player_list_t players;
-      std::unordered_set<player_t> readyForBoss;
-      std::unordered_set<player_t> eliminated;
-      leaderboard_t scores;
+      std::vector<bool> eliminated;
+      std::vector<bool> readyForBoss;
+      std::vector<bool> scored;
+      std::vector<double> scores;
+      std::vector<int> scoreOrder;
+      std::vector<int> eliminationOrder;
+      std::mt19937 random;
+      size_t eliminatedCount;
+      size_t readyCount;
+      size_t scoredCount;
+      uint64_t version;
+      uint64_t cachedVersion;
+      json cached;
   };
 }
 
@@ -1,6 +1,7 @@
 #ifndef BALATROGETHER_LISTENER_H
 #define BALATROGETHER_LISTENER_H
 
+#include <algorithm>
 #include "types.hpp"
 #include "util/misc.hpp"
 #include "util/logs.hpp"
@@ -10,22 +11,32 @@ namespace balatrogether {
   class Event {
     public:
       Event(string command);
-      string getCommand();
-      virtual void execute(T object, client_t client, json req) {};
+      const string& getCommand();
+      virtual void execute(T object, client_t client, json& req) {};
     private:
       string command;
   };
 
+  // Dispatches requests to the event registered for their command. Events are kept in registration order, and
+  // also in a table sorted by command so that a request is matched with a binary search. Requests are passed to
+  // events by reference and never copied. Events hold no state of their own, so one listener can serve any number
+  // of objects by passing the object along with each request. Replies to requests the object is waiting on are
+  // resumed in place of the event, with the same error handling. Requests discarded for breaking their size limits
+  // are answered with an error in their place, and the client is kept
   template <typename T, typename E>
   class EventListener {
     public:
       EventListener(T object);
       virtual ~EventListener();
       void add(E event);
-      bool process(client_t client, json req);
-      virtual void client_error(T object, client_t client, json req, client_exception& e) {};
+      E find(const string& command);
+      bool process(client_t client, json& req);
+      bool process(T object, client_t client, json& req);
+      virtual bool resume(T object, client_t client, json& req) { return false; };
+      virtual void client_error(T object, client_t client, json& req, client_exception& e) {};
     protected:
       std::vector<E> events;
+      std::vector<E> table;
       T object;
   };
 
@@ -36,7 +47,7 @@ namespace balatrogether {
   }
 
   template <typename T>
-  inline string Event<T>::getCommand()
+  inline const string& Event<T>::getCommand()
   {
     return this->command;
   }
@@ -57,28 +68,52 @@ namespace balatrogether {
   inline void EventListener<T, E>::add(E event)
   {
     this->events.push_back(event);
+    auto it = std::lower_bound(this->table.begin(), this->table.end(), event, [](E a, E b) {
+      return a->getCommand() < b->getCommand();
+    });
+    this->table.insert(it, event);
   }
 
+  // Returns the event registered for a command, or nullptr if there is none
   template <typename T, typename E>
-  inline bool EventListener<T, E>::process(client_t client, json req)
+  inline E EventListener<T, E>::find(const string& command)
   {
-    if (!req["cmd"].is_string()) return false;
-    for (E event : this->events) {
-      if (event->getCommand() == req["cmd"].get<string>()) {
-        try {
-          event->execute(this->object, client, req);
-          return true;
-        } catch (client_exception& e) {
-          logger::error << e.what() << std::endl;
-          this->client_error(this->object, client, req, e);
-          return e.keep();
-        } catch (std::exception& e) {
-          logger::error << e.what() << std::endl;
-          return false;
-        }
-      }
+    auto it = std::lower_bound(this->table.begin(), this->table.end(), command, [](E event, const string& command) {
+      return event->getCommand() < command;
+    });
+    if (it == this->table.end() || (*it)->getCommand() != command) return nullptr;
+    return *it;
+  }
+
+  template <typename T, typename E>
+  inline bool EventListener<T, E>::process(client_t client, json& req)
+  {
+    return this->process(this->object, client, req);
+  }
+
+  template <typename T, typename E>
+  inline bool EventListener<T, E>::process(T object, client_t client, json& req)
+  {
+    if (req.is_discarded()) {
+      client_exception e("Request exceeds its size limits");
+      this->client_error(object, client, req, e);
+      return true;
+    }
+    auto cmd = req.find("cmd");
+    if (cmd == req.end() || !cmd->is_string()) return false;
+    E event = this->find(cmd->template get_ref<const string&>());
+    if (!event) return false;
+    try {
+      if (!this->resume(object, client, req)) event->execute(object, client, req);
+      return true;
+    } catch (client_exception& e) {
+      logger::error << e.what() << std::endl;
+      this->client_error(object, client, req, e);
+      return e.keep();
+    } catch (std::exception& e) {
+      logger::error << e.what() << std::endl;
+      return false;
     }
-    return false;
   }
 }
 
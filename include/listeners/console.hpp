@@ -12,7 +12,7 @@ namespace balatrogether {
       std::vector<ConsoleEvent*> getEvents();
       bool processCommand(ConsoleEvent* command, string input);
       bool process(string line);
-      void client_error(server_t server, client_t client, json req, client_exception& e);
+      void client_error(server_t server, client_t client, json& req, client_exception& e);
   };
 }
 
@@ -7,8 +7,9 @@
 namespace balatrogether {
   class LobbyEventListener : public EventListener<lobby_t> {
     public:
-      LobbyEventListener(lobby_t lobby);
-      void client_error(lobby_t lobby, client_t client, json req, client_exception& e);
+      LobbyEventListener();
+      bool resume(lobby_t lobby, client_t client, json& req);
+      void client_error(lobby_t lobby, client_t client, json& req, client_exception& e);
   };
 }
 
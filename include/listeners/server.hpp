@@ -8,7 +8,7 @@ namespace balatrogether {
   class ServerEventListener : public EventListener<server_t> {
     public:
       ServerEventListener(server_t server);
-      void client_error(server_t server, client_t client, json req, client_exception& e);
+      void client_error(server_t server, client_t client, json& req, client_exception& e);
   };
 }
 
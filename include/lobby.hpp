@@ -1,12 +1,20 @@
 #ifndef BALATROGETHER_LOBBY_H
 #define BALATROGETHER_LOBBY_H
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
 #include "types.hpp"
 #include "util/logs.hpp"
+#include "util/mpsc.hpp"
 #include "game.hpp"
+#include "preq.hpp"
 #include "listeners/lobby.hpp"
 
 namespace balatrogether {
+  // A room of players. Only mutable state lives here; the event handlers are shared by every lobby on the server
   class Lobby {
     public:
       Lobby(server_t server, int roomNumber);
@@ -24,20 +32,50 @@ namespace balatrogether {
       void remove(client_t client);
       void close();
 
+      void lock();
+      void unlock();
+
+      bool post(client_t client, json req);
+      bool poke();
+      bool run(size_t limit);
+
+      preq_t ask(string command, client_t creator, preq_reply_t onReply, preq_timeout_t onTimeout);
+      void await(preq_t preq, int timeoutMs);
+      bool resume(client_t client, json& req);
+      void complete(preq_t preq);
+      int getWorker();
+      void setWorker(int worker);
+
       int getRoomNumber();
       server_t getServer();
       lobby_listener_t getEventListener();
       client_list_t getClients();
+      client_t getClient(steamid_t steamId);
       game_t getGame();
       logger::stream getLogger();
       json getJSON();
     private:
+      void send(const client_list_t& clients, json& payload);
+      void expire();
+
       int roomNumber;
       server_t server;
-      lobby_listener_t listener;
       client_list_t clients;
-      logger::stream logger;
-      game_t game;
+      std::unordered_map<steamid_t, client_t> members;
+      Game game;
+      std::recursive_mutex mutex;
+
+      struct request {
+        client_t client;
+        json req;
+      };
+      MPSCQueue<request> inbox;
+      std::atomic<bool> scheduled;
+      std::atomic<int> worker;
+
+      typedef std::pair<std::chrono::steady_clock::time_point, preq_id_t> deadline;
+      std::unordered_map<preq_id_t, preq_t> requests;
+      std::priority_queue<deadline, std::vector<deadline>, std::greater<deadline>> deadlines;
   };
 }
 
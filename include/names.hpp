@@ -0,0 +1,86 @@
+#ifndef BALATROGETHER_NAMES_H
+#define BALATROGETHER_NAMES_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include "types.hpp"
+
+#define NAME_BATCH_SIZE 100
+#define NAME_CACHE_FILE "names.cache"
+#define NAME_BREAKER_FAILURES 5
+#define NAME_BREAKER_COOLDOWN_S 30
+#define NAME_CONNECT_TIMEOUT_S 2
+#define NAME_READ_TIMEOUT_S 5
+
+namespace httplib {
+  class Client;
+}
+
+namespace balatrogether {
+  typedef std::unordered_map<steamid_t, string> name_map_t;
+
+  // Display names that have already been fetched, evicting the least recently used once full. Entries expire on the
+  // monotonic clock; the snapshot stores wall clock expiry times so that they survive a restart. Not thread safe
+  class NameCache {
+    public:
+      NameCache(size_t capacity, int ttl);
+
+      bool get(steamid_t steamId, string& name);
+      void put(steamid_t steamId, const string& name);
+      size_t size();
+
+      bool load(const string& path);
+      bool save(const string& path);
+    private:
+      void insert(steamid_t steamId, const string& name, std::chrono::steady_clock::time_point expires);
+
+      struct entry {
+        steamid_t steamId;
+        string name;
+        std::chrono::steady_clock::time_point expires;
+      };
+
+      std::list<entry> entries;
+      std::unordered_map<steamid_t, std::list<entry>::iterator> index;
+      size_t capacity;
+      std::chrono::seconds ttl;
+  };
+
+  // Looks up Steam display names off the request path. Unknown IDs are queued and fetched in batches by a pool of
+  // workers, each holding a keep-alive connection to the Web API. Once a batch arrives the names are stored on the
+  // players and every affected lobby is sent its updated player list. After repeated failures the API is left alone
+  // for a cooldown period, then tried again with a single batch
+  class NameResolver {
+    public:
+      NameResolver(server_t server, string url, string key, int threads, size_t cacheSize, int cacheTTL);
+      ~NameResolver();
+
+      string lookup(steamid_t steamId);
+      void stop();
+    private:
+      bool fetch(httplib::Client& http, const std::vector<steamid_t>& ids, name_map_t& names);
+      void publish(const name_map_t& names);
+      void loop();
+
+      server_t server;
+      string url;
+      string key;
+      std::vector<std::thread> workers;
+      std::mutex mutex;
+      std::condition_variable ready;
+      std::deque<steamid_t> pending;
+      std::unordered_set<steamid_t> queued;
+      NameCache cache;
+      std::chrono::steady_clock::time_point openUntil;
+      int failures;
+      bool running;
+  };
+}
+
+#endif
@@ -6,21 +6,42 @@
 #include "player.hpp"
 
 #define BUFFER_SIZE 65536
+#define MAX_MESSAGE_SIZE (16 * BUFFER_SIZE)
+#define WRITE_IOV_MAX 64
+#define SEND_STALL_MS 5000
+#define SEND_STALL_CHECK_MS 1000
+#define SEND_HARD_LIMIT_FACTOR 4
 
 namespace balatrogether {
+  enum HandshakeStatus : int {
+    HANDSHAKE_FAILED = -1,
+    HANDSHAKE_PENDING,
+    HANDSHAKE_COMPLETE,
+  };
+  typedef enum HandshakeStatus handshake_status_t;
+
   class NetworkManager {
     public:
-      NetworkManager(bool ssl, bool outputKey);
+      NetworkManager(bool ssl, bool outputKey, size_t highWater);
       ~NetworkManager();
-      bool handshake(client_t c);
-      void send(client_list_t receivers, json payload);
-      json receive(client_t sender);
+      void attach(reactor_t reactor);
+      handshake_status_t handshake(client_t c);
+      void send(const client_list_t& receivers, const json& payload);
+      bool receive(client_t sender, std::vector<json>& messages);
+      bool frame(client_t sender, const char* data, size_t bytes, std::vector<json>& messages);
+      bool flush(client_t c);
+      bool checkStall(client_t c);
+      bool isReadBlocked(client_t c);
+      bool isCosmetic(const json& payload);
     private:
-      size_t peek(client_t client, char* buffer, size_t bytes);
-      size_t read(client_t client, char* buffer, size_t bytes);
-      size_t write(client_t client, char* buffer, size_t bytes);
+      bool enqueue(client_t c, const wire_buffer_t& buffer, bool cosmetic);
+      bool drain(client_t c);
+      bool extract(client_t sender, std::vector<json>& messages);
+      ssize_t read(client_t client, char* buffer, size_t bytes);
       SSL_CTX* ssl_ctx = nullptr;
+      size_t highWater;
+      reactor_t reactor = nullptr;
   };
 }
 
-#endif
\ No newline at end of file
+#endif
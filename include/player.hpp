@@ -1,6 +1,7 @@
 #ifndef BALATROGETHER_PLAYER_H
 #define BALATROGETHER_PLAYER_H
 
+#include <mutex>
 #include "types.hpp"
 #include "util/misc.hpp"
 
@@ -11,14 +12,20 @@ namespace balatrogether {
 
       client_t getClient();
       string getName();
+      void setName(string name);
       steamid_t getSteamId();
       string getUnlocks();
       int getUnlockedStake(string deck);
     private:
       friend class Client;
+      friend class Game;
+      friend class Lobby;
       player_auth auth;
       string name;
+      std::mutex mutex;
       client_t client = nullptr;
+      int slot = -1;
+      uint64_t stateVersion = 0;
   };
 }
 
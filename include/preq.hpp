@@ -1,37 +1,93 @@
 #ifndef BALATROGETHER_PREQ_H
 #define BALATROGETHER_PREQ_H
 
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <random>
 #include "types.hpp"
 
+#define PREQ_CARD_SAMPLE 20
+#define PREQ_LATENCY_SAMPLES 1024
+
 namespace balatrogether {
+  typedef std::function<void(preq_t, client_t, json&)> preq_reply_t;
+  typedef std::function<void(preq_t)> preq_timeout_t;
+
+  // A request that a lobby event sends to other players and then waits on, such as a joker swap. The event hands
+  // the lobby two continuations: one that is resumed with each reply, and one that is resumed if the deadline
+  // passes first. Both run on the lobby's executor under the lobby lock, and either may complete the request or
+  // wait on it again. Replies are collected in place: contributors are tracked by their slot in the run, and the
+  // jokers they send are moved in. Cards are reservoir sampled as they arrive, so only PREQ_CARD_SAMPLE of them are
+  // ever held
   class PersistentRequest {
     public:
-      string getId();
+      preq_id_t getId();
+      string getType();
       steamid_t getCreator();
-      json getData();
-      void setData(json data);
+      lobby_t getLobby();
+      int getTarget();
+      void setTarget(int slot);
+      long getAge();
+
+      bool hasContributed(int slot);
+      void contribute(int slot);
+      bool isComplete(game_t game);
+      std::vector<json>& getJokers();
+      void addCard(json& card, std::mt19937& random);
+      std::vector<json>& drawCards(std::mt19937& random);
     private:
+      friend class Lobby;
       friend class PersistentRequestManager;
-      PersistentRequest(steamid_t creator);
-      string id;
+      PersistentRequest(preq_id_t id, string type, steamid_t creator, lobby_t lobby, preq_reply_t onReply, preq_timeout_t onTimeout);
+      preq_id_t id;
+      string type;
       steamid_t original;
-      json data;
-      clock_t created;
+      lobby_t lobby;
+      int target = -1;
+      std::vector<bool> contributed;
+      std::vector<json> jokers;
+      std::vector<json> cards;
+      uint64_t cardsSeen = 0;
+      preq_reply_t onReply;
+      preq_timeout_t onTimeout;
+      std::chrono::steady_clock::time_point deadline;
+      std::chrono::steady_clock::time_point created;
+      bool timedOut = false;
   };
 
+  // Hands out request IDs and keeps counts and latencies of requests across every lobby. The requests themselves
+  // are held by the lobby that is waiting on them
   class PersistentRequestManager {
     public:
-      PersistentRequestManager(int requestLifetime = 10, int collectionInterval = 60);
-      ~PersistentRequestManager();
-      preq_t create(steamid_t creator);
-      preq_t getById(string requestId);
-      void complete(string requestId);
-      void clearUnresolved();
+      PersistentRequestManager();
+      preq_t create(string type, steamid_t creator, lobby_t lobby, preq_reply_t onReply, preq_timeout_t onTimeout);
+      void complete(preq_t preq, bool partial);
+      void expire(preq_t preq);
+
+      uint64_t getPendingCount();
+      uint64_t getCreatedCount();
+      uint64_t getCompletedCount();
+      uint64_t getPartialCount();
+      uint64_t getExpiredCount();
+      std::map<string, std::vector<long>> getLatencies();
     private:
-      std::unordered_map<string, preq_t> requests;
-      int requestLifetime;
-      int collectionInterval;
+      void record(preq_t preq);
+
+      struct latency {
+        std::vector<long> samples;
+        size_t next = 0;
+      };
+
+      std::map<string, latency> latencies;
+      std::mt19937_64 random;
+      std::mutex mutex;
+      uint64_t created;
+      uint64_t completed;
+      uint64_t partial;
+      uint64_t expired;
   };
 }
 
-#endif
\ No newline at end of file
+#endif
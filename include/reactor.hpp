@@ -0,0 +1,24 @@
+#ifndef BALATROGETHER_REACTOR_H
+#define BALATROGETHER_REACTOR_H
+
+#include "types.hpp"
+
+namespace balatrogether {
+  class Reactor {
+    public:
+      Reactor(server_t server);
+      virtual ~Reactor() {};
+
+      virtual void run() = 0;
+      virtual void stop() = 0;
+      virtual void add(client_t c) = 0;
+      virtual bool submit(client_t) { return false; };
+      virtual void commit() {};
+    protected:
+      bool dispatch(client_t c, std::vector<json>& messages);
+      void release(client_t c);
+      server_t server;
+  };
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef BALATROGETHER_EPOLL_REACTOR_H
+#define BALATROGETHER_EPOLL_REACTOR_H
+
+#include <atomic>
+#include <thread>
+#include "reactor.hpp"
+
+#define EPOLL_MAX_EVENTS 256
+
+namespace balatrogether {
+  class EpollReactor : public Reactor {
+    public:
+      EpollReactor(server_t server, int listenfd, int threads);
+      ~EpollReactor();
+
+      void run();
+      void stop();
+      void add(client_t c);
+    private:
+      void loop(int index);
+      void handle(int epfd, client_t c, uint32_t events);
+      void forget(int epfd, client_t c);
+      int listenfd;
+      int wakefd;
+      std::vector<int> epfds;
+      std::vector<std::thread> threads;
+      std::atomic<size_t> next;
+      std::atomic<bool> running;
+  };
+}
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef BALATROGETHER_URING_REACTOR_H
+#define BALATROGETHER_URING_REACTOR_H
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <sys/socket.h>
+#include <linux/io_uring.h>
+#include "reactor.hpp"
+
+#define URING_ENTRIES 4096
+#define URING_BUFFER_COUNT 1024
+#define URING_BUFFER_SIZE 4096
+#define URING_BUFFER_GROUP 0
+#define URING_SEND_BATCH 64
+
+namespace balatrogether {
+  class UringReactor : public Reactor {
+    public:
+      UringReactor(server_t server, int listenfd);
+      ~UringReactor();
+      static bool isSupported();
+
+      void run();
+      void stop();
+      void add(client_t c);
+      bool submit(client_t c);
+      void commit();
+    private:
+      struct connection {
+        struct msghdr msg;
+        std::vector<struct iovec> iov;
+        bool sending = false;
+        bool receiving = true;
+      };
+
+      struct io_uring_sqe *sqe(uint64_t tag, void *ptr);
+      void flush(bool wait);
+      void accept();
+      void receive(client_t c);
+      void sendAll(client_t c, connection& conn);
+      void recycle(uint16_t bid);
+      void onAccept(struct io_uring_cqe *cqe);
+      void onReceive(client_t c, struct io_uring_cqe *cqe);
+      void onSend(client_t c, struct io_uring_cqe *cqe);
+
+      int listenfd;
+      int ringfd;
+      std::atomic<bool> running;
+      std::mutex mutex;
+      std::unordered_map<client_t, connection> connections;
+
+      void *sqRing;
+      size_t sqRingSize;
+      void *cqRing;
+      size_t cqRingSize;
+      unsigned *sqHead;
+      unsigned *sqTail;
+      unsigned *sqMask;
+      unsigned *sqArray;
+      unsigned sqEntries;
+      unsigned sqLocalTail;
+      unsigned toSubmit = 0;
+      struct io_uring_sqe *sqes;
+      size_t sqesSize;
+      unsigned *cqHead;
+      unsigned *cqTail;
+      unsigned *cqMask;
+      struct io_uring_cqe *cqes;
+
+      struct io_uring_buf_ring *bufRing;
+      uint16_t bufTail = 0;
+      char *buffers;
+  };
+}
+
+#endif
@@ -1,7 +1,10 @@
 #ifndef BALATROGETHER_SERVER_H
 #define BALATROGETHER_SERVER_H
 
+#include <condition_variable>
 #include <mutex>
+#include <thread>
+#include <unordered_map>
 #include "types.hpp"
 #include "network.hpp"
 #include "preq.hpp"
@@ -15,6 +18,7 @@ namespace balatrogether {
       Server(int port);
       ~Server();
 
+      void run();
       void acceptClient();
 
       bool canConnect(client_t c);
@@ -29,25 +33,38 @@ namespace balatrogether {
       void unlock();
 
       client_list_t getClients();
+      client_t getClient(steamid_t steamId);
       network_t getNetworkManager();
+      executor_t getExecutor();
+      name_resolver_t getNameResolver();
       config_t getConfig();
       server_listener_t getEventListener();
+      lobby_listener_t getLobbyEventListener();
       console_listener_t getConsole();
       preq_manager_t getPersistentRequestManager();
     private:
+      void watch();
       void setSocketOption(int level, int option, int value, const char *err_message = "Failed to set option");
       network_t net;
+      reactor_t reactor;
+      executor_t executor;
+      name_resolver_t names;
       server_listener_t listener;
+      lobby_listener_t lobbyListener;
       console_listener_t console;
       client_list_t clients;
+      std::unordered_map<steamid_t, size_t> registry;
       lobby_list_t lobbies;
       std::mutex mutex;
+      std::thread watchdog;
+      std::mutex watchMutex;
+      std::condition_variable watchWake;
+      bool watching;
       config_t config;
       preq_manager_t persistentRequests;
       int sockfd;
   };
 
-  void client_thread(server_t server, client_t client);
   void console_thread(server_t server);
 }
 
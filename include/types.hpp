@@ -1,6 +1,7 @@
 #ifndef BALATROGETHER_TYPES_H
 #define BALATROGETHER_TYPES_H
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include "json.hpp"
@@ -8,7 +9,7 @@
 namespace balatrogether {
   using json = nlohmann::json;
   using string = std::string;
-  typedef std::string steamid_t;
+  typedef uint64_t steamid_t;
 
   // server.hpp
   class Server;
@@ -32,7 +33,8 @@ namespace balatrogether {
   // preq.hpp
   class PersistentRequest;
   class PersistentRequestManager;
-  typedef PersistentRequest* preq_t;
+  typedef std::shared_ptr<PersistentRequest> preq_t;
+  typedef uint64_t preq_id_t;
   typedef PersistentRequestManager* preq_manager_t;
 
   // client.hpp
@@ -48,6 +50,25 @@ namespace balatrogether {
   // network.hpp
   class NetworkManager;
   typedef NetworkManager* network_t;
+  typedef std::shared_ptr<const string> wire_buffer_t;
+
+  // executor.hpp
+  class LobbyExecutor;
+  typedef LobbyExecutor* executor_t;
+
+  // names.hpp
+  class NameResolver;
+  typedef NameResolver* name_resolver_t;
+
+  // reactor.hpp
+  class Reactor;
+  typedef Reactor* reactor_t;
+
+  // reactors/epoll.hpp
+  class EpollReactor;
+
+  // reactors/uring.hpp
+  class UringReactor;
 
   // listener.hpp
   template <typename T> class Event;
@@ -0,0 +1,64 @@
+#ifndef BALATROGETHER_BUFFER_UTIL_H
+#define BALATROGETHER_BUFFER_UTIL_H
+
+#include <sys/uio.h>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include "types.hpp"
+
+#define READ_BUFFER_MIN 4096
+
+namespace balatrogether {
+  // Per-connection input buffer. Bytes are read directly into its free space, complete lines are handed out in
+  // place, and a trailing partial line is carried over to the next read
+  class ReadBuffer {
+    public:
+      ReadBuffer(size_t limit);
+
+      char *reserve(size_t& bytes);
+      void commit(size_t bytes);
+      bool next(const char*& line, size_t& length);
+      size_t pending();
+    private:
+      std::vector<char> data;
+      size_t start = 0;
+      size_t end = 0;
+      size_t scanned = 0;
+      size_t limit;
+  };
+
+  // Per-connection output queue of shared wire buffers, tracking how much of the oldest one has been written
+  class WriteQueue {
+    public:
+      void push(const wire_buffer_t& buffer, bool cosmetic);
+      void drop();
+      size_t purge();
+      int gather(struct iovec *iov, int max);
+      int claim(struct iovec *iov, int max);
+      void settle();
+      void retry();
+      void consume(size_t bytes);
+
+      bool empty();
+      size_t size();
+      size_t bytes();
+      long stalled();
+      uint64_t dropped();
+    private:
+      struct entry {
+        wire_buffer_t buffer;
+        bool cosmetic;
+      };
+      std::deque<entry> entries;
+      size_t offset = 0;
+      size_t busy = 0;
+      bool pending = false;
+      size_t total = 0;
+      size_t cosmetics = 0;
+      uint64_t drops = 0;
+      std::chrono::steady_clock::time_point progress;
+  };
+}
+
+#endif
@@ -2,46 +2,40 @@
 #define BALATROGETHER_LOGS_UTIL_H
 
 #include <iostream>
-#include <mutex>
+#include <sstream>
 #include "types.hpp"
 
+#define LOG_RING_SIZE 1024
+#define LOG_IDLE_MS 100
+
 namespace balatrogether::logger {
+  // Each thread builds its line locally. Finished lines are handed to a writer thread through a per-thread ring, so
+  // logging never blocks on the output stream or on other threads
+  std::ostream& begin(const string& prefix, std::ostream& os, const string& color);
+  void end();
+
   class stream {
     public:
-      stream(string prefix = "", std::ostream& os = std::cout, string color = "0") : new_line(true), was_flushed(true), on(true), prefix(prefix), os(os), color(color) {};
-      stream(const stream &other) : new_line(other.new_line), on(other.on), prefix(other.prefix), os(other.os), color(other.color) {};
+      stream(string prefix = "", std::ostream& os = std::cout, string color = "0") : on(true), prefix(prefix), os(os), color(color) {};
+      stream(const stream &other) : on(other.on), prefix(other.prefix), os(other.os), color(other.color) {};
       template<class T> stream &operator<<(T val) {
         if (!on) return *this;
-        if (was_flushed) {
-          mutex.lock();
-          was_flushed = false;
-        }
-        if (new_line) {
-          std::time_t t = std::time(nullptr);
-          os << "\033[" << color << "m[" << std::put_time(std::gmtime(&t), "%FT%TZ") << "] " << prefix;
-          new_line = false;
-        }
-        os << val;
+        begin(prefix, os, color) << val;
         return *this;
       };
       stream &operator<<(std::ostream& (*fn)(std::ostream&)) {
         if (!on) return *this;
-        bool is_endl = fn == (std::ostream& (*)(std::ostream&)) std::endl;
-        bool is_flush = is_endl || fn == (std::ostream& (*)(std::ostream&)) std::flush;
-        if (is_flush) os << "\033[34m";
-        os << fn;
-        if (is_endl) new_line = true;
-        if (is_flush) {
-          was_flushed = true;
-          mutex.unlock();
+        if (fn == (std::ostream& (*)(std::ostream&)) std::endl) {
+          begin(prefix, os, color);
+          end();
+        } else if (fn != (std::ostream& (*)(std::ostream&)) std::flush) {
+          begin(prefix, os, color) << fn;
         }
         return *this;
       };
       void setEnabled(bool enabled) { on = enabled; };
+      bool isEnabled() { return on; };
     private:
-      static std::mutex mutex;
-      bool new_line;
-      bool was_flushed;
       bool on;
       string prefix;
       std::ostream& os;
@@ -53,4 +47,4 @@ namespace balatrogether::logger {
   extern stream error;
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -16,11 +16,12 @@ namespace balatrogether {
     steamid_t steamId;
     string unlockHash;
     std::unordered_map<string, int> stakes;
-    string fetchKey;
+    bool stateDiff;
   };
 
   string getpath();
-  string getplayername(player_auth& auth);
+  bool parsedecimal(const string& str, uint64_t& value);
+  bool parsesteamid(const string& str, steamid_t& id);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,86 @@
+#ifndef BALATROGETHER_MPSC_UTIL_H
+#define BALATROGETHER_MPSC_UTIL_H
+
+#include <atomic>
+#include <utility>
+
+namespace balatrogether {
+  // Unbounded lock-free queue with any number of producers and a single consumer. Producers only swap the head
+  // pointer, so posting never blocks behind the consumer. The first stub node is kept inline, so an empty queue
+  // that has never been used allocates nothing
+  template <typename T>
+  class MPSCQueue {
+    public:
+      MPSCQueue();
+      ~MPSCQueue();
+      void push(T value);
+      bool pop(T& value);
+      bool empty();
+    private:
+      struct node {
+        std::atomic<node*> next;
+        T value;
+      };
+      void release(node *n);
+
+      node stub;
+      std::atomic<node*> head;
+      node *tail;
+  };
+
+  template <typename T>
+  inline MPSCQueue<T>::MPSCQueue()
+  {
+    this->stub.next = nullptr;
+    this->head = &this->stub;
+    this->tail = &this->stub;
+  }
+
+  template <typename T>
+  inline MPSCQueue<T>::~MPSCQueue()
+  {
+    T value;
+    while (this->pop(value));
+    this->release(this->tail);
+  }
+
+  // Appends a value. Safe to call from any thread
+  template <typename T>
+  inline void MPSCQueue<T>::push(T value)
+  {
+    node *n = new node;
+    n->next = nullptr;
+    n->value = std::move(value);
+    node *prev = this->head.exchange(n);
+    prev->next.store(n);
+  }
+
+  // Removes the oldest value. Only the consumer may call this. A push that is still linking its node is not
+  // visible yet, so a producer must check whether the consumer needs waking after pushing
+  template <typename T>
+  inline bool MPSCQueue<T>::pop(T& value)
+  {
+    node *next = this->tail->next.load();
+    if (!next) return false;
+    value = std::move(next->value);
+    next->value = T();
+    this->release(this->tail);
+    this->tail = next;
+    return true;
+  }
+
+  // Returns true if there is nothing for the consumer to pop. Only the consumer may call this
+  template <typename T>
+  inline bool MPSCQueue<T>::empty()
+  {
+    return this->tail->next.load() == nullptr;
+  }
+
+  template <typename T>
+  inline void MPSCQueue<T>::release(node *n)
+  {
+    if (n != &this->stub) delete n;
+  }
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef BALATROGETHER_REQUEST_UTIL_H
+#define BALATROGETHER_REQUEST_UTIL_H
+
+#include "types.hpp"
+
+// Default limits, several times the largest fixed-shape request. A JOIN with 20 stakes is under 1 KB with at
+// most 20 elements at depth 2
+#define REQUEST_MAX_BYTES 16384
+#define REQUEST_MAX_DEPTH 4
+#define REQUEST_MAX_ELEMENTS 64
+
+namespace balatrogether::request {
+  enum ParseStatus : int {
+    PARSE_OK,
+    PARSE_INVALID,
+    PARSE_TOO_LARGE,
+  };
+  typedef enum ParseStatus parse_status_t;
+
+  // Size limits for one command. Elements are counted per array or object
+  struct limits {
+    size_t bytes;
+    size_t depth;
+    size_t elements;
+  };
+
+  parse_status_t parse(const char* data, size_t length, json& result);
+  const limits& getLimits(const string& cmd);
+}
+
+#endif
@@ -1,11 +1,13 @@
 #include <unistd.h>
+#include <sys/socket.h>
 #include "client.hpp"
+#include "network.hpp"
 #include "player.hpp"
 #include "lobby.hpp"
 
 using namespace balatrogether;
 
-Client::Client(int fd, sockaddr_in addr)
+Client::Client(int fd, sockaddr_in addr) : lobby(nullptr), inbox(MAX_MESSAGE_SIZE), closed(false), refs(1)
 {
   this->fd = fd;
   this->addr = addr;
@@ -13,12 +15,12 @@ Client::Client(int fd, sockaddr_in addr)
 
 Client::~Client()
 {
-  close(this->fd);
   if (this->ssl) {
     SSL_shutdown(this->ssl);
     SSL_free(this->ssl);
     this->ssl = nullptr;
   }
+  ::close(this->fd);
   if (this->player) this->player->client = nullptr;
 }
 
@@ -29,7 +31,7 @@ int Client::getFd()
 
 string Client::getIdentity()
 {
-  if (this->getPlayer()) return this->getPlayer()->getSteamId();
+  if (this->getPlayer()) return std::to_string(this->getPlayer()->getSteamId());
   return this->getIP();
 }
 
@@ -70,4 +72,53 @@ lobby_t Client::getLobby()
 void Client::setLobby(lobby_t lobby)
 {
   this->lobby = lobby;
+}
+
+bool Client::isClosed()
+{
+  return this->closed;
+}
+
+// Shuts down the socket so that the event loop owning this client releases it
+void Client::close()
+{
+  if (this->closed.exchange(true)) return;
+  shutdown(this->fd, SHUT_RDWR);
+}
+
+// Keeps the client alive while a queued lobby request still refers to it
+void Client::ref()
+{
+  this->refs++;
+}
+
+// Drops a reference, freeing the client once its event loop and every queued request are done with it
+void Client::unref()
+{
+  if (--this->refs == 0) delete this;
+}
+
+size_t Client::getQueuedMessages()
+{
+  std::lock_guard<std::mutex> guard(this->io);
+  return this->outbox.size();
+}
+
+size_t Client::getQueuedBytes()
+{
+  std::lock_guard<std::mutex> guard(this->io);
+  return this->outbox.bytes();
+}
+
+// Returns how many milliseconds the client has had output queued without accepting any of it
+long Client::getStallTime()
+{
+  std::lock_guard<std::mutex> guard(this->io);
+  return this->outbox.stalled();
+}
+
+uint64_t Client::getDroppedMessages()
+{
+  std::lock_guard<std::mutex> guard(this->io);
+  return this->outbox.dropped();
 }
\ No newline at end of file
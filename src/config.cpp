@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "util/logs.hpp"
 #include "util/misc.hpp"
 #include "config.hpp"
@@ -9,24 +10,43 @@ Config::Config()
   FILE* config_file = fopen((getpath() + "/config.json").c_str(), "r");
   if (config_file) {
     json config = json::parse(config_file);
+    this->saved = config;
     if (config["max_players"].is_number_integer()) 
       this->maxPlayers = config["max_players"].get<int>();
     if (config["max_lobbies"].is_number_integer()) 
       this->maxLobbies = config["max_lobbies"].get<int>();
+    if (config["io_threads"].is_number_integer()) 
+      this->ioThreads = std::max(1, config["io_threads"].get<int>());
+    if (config["io_backend"].is_string()) 
+      this->ioBackend = config["io_backend"].get<string>();
+    if (config["send_high_water"].is_number_unsigned()) 
+      this->sendHighWater = config["send_high_water"].get<size_t>();
+    if (config["lobby_workers"].is_number_integer()) 
+      this->lobbyWorkers = std::max(1, config["lobby_workers"].get<int>());
+    if (config["lobby_steal_threshold"].is_number_integer()) 
+      this->lobbyStealThreshold = std::max(0, config["lobby_steal_threshold"].get<int>());
     if (config["tls_enabled"].is_boolean()) 
       this->tlsEnabled = config["tls_enabled"].get<bool>();
     if (config["banned_users"].is_array()) 
-      this->banned = config["banned_users"].get<steamid_list_t>();
+      load(config["banned_users"], "banned_users", this->banned, this->bannedList);
     if (config["whitelist_enabled"].is_boolean()) 
       this->whitelistEnabled = config["whitelist_enabled"].get<bool>();
     if (config["whitelist"].is_array()) 
-      this->whitelisted = config["whitelist"].get<steamid_list_t>();
+      load(config["whitelist"], "whitelist", this->whitelisted, this->whitelistedList);
     if (config["steam_api_key"].is_null()) 
       this->steamApiEnabled = false;
     if (config["steam_api_key"].is_string()) { 
       this->steamApiEnabled = true;
       this->steamApiKey = config["steam_api_key"].get<string>();
     }
+    if (config["steam_api_url"].is_string()) 
+      this->steamApiUrl = config["steam_api_url"].get<string>();
+    if (config["steam_api_workers"].is_number_integer()) 
+      this->steamApiWorkers = std::max(1, config["steam_api_workers"].get<int>());
+    if (config["name_cache_size"].is_number_unsigned()) 
+      this->nameCacheSize = config["name_cache_size"].get<size_t>();
+    if (config["name_cache_ttl"].is_number_integer()) 
+      this->nameCacheTTL = std::max(0, config["name_cache_ttl"].get<int>());
     fclose(config_file);
     logger::info << "Config loaded from config.json" << std::endl;
   } else {
@@ -50,6 +70,31 @@ int Config::getMaxLobbies()
   return this->maxLobbies;
 }
 
+int Config::getIOThreads()
+{
+  return this->ioThreads;
+}
+
+string Config::getIOBackend()
+{
+  return this->ioBackend;
+}
+
+size_t Config::getSendHighWater()
+{
+  return this->sendHighWater;
+}
+
+int Config::getLobbyWorkers()
+{
+  return this->lobbyWorkers;
+}
+
+int Config::getLobbyStealThreshold()
+{
+  return this->lobbyStealThreshold;
+}
+
 bool Config::isTLSEnabled()
 {
   return this->tlsEnabled;
@@ -68,57 +113,41 @@ void Config::setWhitelistEnabled(bool whitelistEnabled)
 
 bool Config::isBanned(steamid_t steamId)
 {
-  for (steamid_t id : this->banned) {
-    if (id == steamId) return true;
-  }
-  return false;
+  return this->banned.count(steamId) > 0;
 }
 
 void Config::ban(steamid_t steamId)
 {
-  if (this->isBanned(steamId)) return;
-  this->banned.push_back(steamId);
+  if (!this->banned.insert(steamId).second) return;
+  this->bannedList.push_back(std::to_string(steamId));
   save();
 }
 
 void Config::unban(steamid_t steamId)
 {
-  for (int i = 0; i < this->banned.size(); i++) {
-    steamid_t id = this->banned.at(i);
-    if (id == steamId) {
-      this->banned.erase(this->banned.begin() + i);
-      save();
-      return;
-    }
-  }
+  if (this->banned.erase(steamId) == 0) return;
+  remove(this->bannedList, steamId);
+  save();
 }
 
 bool Config::isWhitelisted(steamid_t steamId)
 {
   if (!this->whitelistEnabled) return true;
-  for (steamid_t id : this->whitelisted) {
-    if (id == steamId) return true;
-  }
-  return false;
+  return this->whitelisted.count(steamId) > 0;
 }
 
 void Config::whitelist(steamid_t steamId)
 {
-  if (this->isWhitelisted(steamId)) return;
-  this->whitelisted.push_back(steamId);
+  if (!this->whitelisted.insert(steamId).second) return;
+  this->whitelistedList.push_back(std::to_string(steamId));
   save();
 }
 
 void Config::unwhitelist(steamid_t steamId)
 {
-  for (int i = 0; i < this->whitelisted.size(); i++) {
-    steamid_t id = this->whitelisted.at(i);
-    if (id == steamId) {
-      this->whitelisted.erase(this->whitelisted.begin() + i);
-      save();
-      return;
-    }
-  }
+  if (this->whitelisted.erase(steamId) == 0) return;
+  remove(this->whitelistedList, steamId);
+  save();
 }
 
 bool Config::isSteamApiEnabled()
@@ -131,22 +160,89 @@ string Config::getSteamApiKey()
   return this->steamApiKey;
 }
 
+string Config::getSteamApiUrl()
+{
+  return this->steamApiUrl;
+}
+
+int Config::getSteamApiWorkers()
+{
+  return this->steamApiWorkers;
+}
+
+size_t Config::getNameCacheSize()
+{
+  return this->nameCacheSize;
+}
+
+int Config::getNameCacheTTL()
+{
+  return this->nameCacheTTL;
+}
+
+// Reads a list of Steam IDs from the config into a set for lookups. The list itself is kept as it was written, so
+// that saving leaves the operator's order alone. Entries that are not Steam IDs can never match a player; they are
+// reported, but kept in the list
+void Config::load(json& list, const char *name, steamid_set_t& ids, json& entries)
+{
+  ids.reserve(list.size());
+  for (json& entry : list) {
+    steamid_t id;
+    if (entry.is_string() && parsesteamid(entry.get_ref<const string&>(), id)) {
+      ids.insert(id);
+    } else {
+      logger::error << "Ignoring invalid Steam ID " << entry.dump() << " in " << name << std::endl;
+    }
+  }
+  entries = list;
+}
+
+// Removes every entry for a Steam ID from a list in the config
+void Config::remove(json& entries, steamid_t steamId)
+{
+  json kept = json::array();
+  for (json& entry : entries) {
+    steamid_t id;
+    if (entry.is_string() && parsesteamid(entry.get_ref<const string&>(), id) && id == steamId) continue;
+    kept.push_back(std::move(entry));
+  }
+  entries = std::move(kept);
+}
+
+// Writes the config back to config.json if it differs from what is already there, so that starting the server
+// does not rewrite a file that has nothing to add
 void Config::save()
 {
-  FILE* config_file = fopen((getpath() + "/config.json").c_str(), "w");
   json config = {
     {"max_players", this->maxPlayers},
     {"max_lobbies", this->maxLobbies},
+    {"io_threads", this->ioThreads},
+    {"io_backend", this->ioBackend},
+    {"send_high_water", this->sendHighWater},
+    {"lobby_workers", this->lobbyWorkers},
+    {"lobby_steal_threshold", this->lobbyStealThreshold},
     {"tls_enabled", this->tlsEnabled},
-    {"banned_users", this->banned},
+    {"banned_users", this->bannedList},
     {"whitelist_enabled", this->whitelistEnabled},
-    {"whitelist", this->whitelisted}
+    {"whitelist", this->whitelistedList},
+    {"steam_api_url", this->steamApiUrl},
+    {"steam_api_workers", this->steamApiWorkers},
+    {"name_cache_size", this->nameCacheSize},
+    {"name_cache_ttl", this->nameCacheTTL}
   };
   if (this->steamApiEnabled) {
     config["steam_api_key"] = this->steamApiKey;
   } else {
     config["steam_api_key"] = json();
   }
-  fprintf(config_file, config.dump(2).c_str());
+  if (config == this->saved) return;
+
+  FILE* config_file = fopen((getpath() + "/config.json").c_str(), "w");
+  if (!config_file) {
+    logger::error << "Failed to save config.json" << std::endl;
+    return;
+  }
+  fputs(config.dump(2).c_str(), config_file);
   fclose(config_file);
+  this->saved = std::move(config);
 }
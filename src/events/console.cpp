@@ -40,7 +40,7 @@ string ConsoleEvent::getUsage()
   return usage;
 }
 
-void HelpCommand::execute(server_t server, client_t client, json args)
+void HelpCommand::execute(server_t server, client_t client, json& args)
 {
   logger::info << "Command list:" << std::endl;
   for (ConsoleEvent* event : server->getConsole()->getEvents()) {
@@ -48,7 +48,7 @@ void HelpCommand::execute(server_t server, client_t client, json args)
   }
 }
 
-void PlayerListCommand::execute(server_t server, client_t client, json args)
+void PlayerListCommand::execute(server_t server, client_t client, json& args)
 {
   client_list_t clients = server->getClients();
   if (args.size() >= 1) {
@@ -69,7 +69,7 @@ void PlayerListCommand::execute(server_t server, client_t client, json args)
   }
 }
 
-void StopCommand::execute(server_t server, client_t client, json args)
+void StopCommand::execute(server_t server, client_t client, json& args)
 {
   lobby_t lobby = nullptr;
   if (args.size() >= 1) {
@@ -80,12 +80,15 @@ void StopCommand::execute(server_t server, client_t client, json args)
     logger::info << "Stopping room " << lobby->getRoomNumber() << std::endl;
     lobby->close();
   } else {
+    // The console holds the server lock while running commands. Shutting down joins threads that may be waiting on
+    // it, such as a name resolver worker publishing names, so it is released first
+    server->unlock();
     delete server;
     exit(0);
   }
 }
 
-void LobbyListCommand::execute(server_t server, client_t client, json args)
+void LobbyListCommand::execute(server_t server, client_t client, json& args)
 {
   lobby_list_t lobbies = server->getLobbies();
   size_t page = 1;
@@ -106,35 +109,43 @@ void LobbyListCommand::execute(server_t server, client_t client, json args)
   }
 }
 
-void KickCommand::execute(server_t server, client_t client, json args)
+// Reads the Steam ID argument of a console command
+static steamid_t steamIdArgument(json& args)
 {
-  for (client_t c : server->getClients()) {
-    if (!c->getPlayer()) continue;
-    if (args["id"].get<steamid_t>() == c->getPlayer()->getSteamId()) {
-      server->disconnect(c);
-      logger::info << "Player " << args["id"].get<steamid_t>() << " kicked" << std::endl;
-    }
-  }
+  steamid_t steamId;
+  if (!args["id"].is_string() || !parsesteamid(args["id"].get_ref<const string&>(), steamId)) throw std::invalid_argument("Invalid Steam ID");
+  return steamId;
+}
+
+void KickCommand::execute(server_t server, client_t client, json& args)
+{
+  steamid_t steamId = steamIdArgument(args);
+  client_t c = server->getClient(steamId);
+  if (!c) return;
+  server->disconnect(c);
+  logger::info << "Player " << steamId << " kicked" << std::endl;
 }
 
-void BanCommand::execute(server_t server, client_t client, json args)
+void BanCommand::execute(server_t server, client_t client, json& args)
 {
   for (ConsoleEvent* event : server->getConsole()->getEvents()) {
     if (event->getCommand() == "kick") {
       event->execute(server, client, args);
     }
   }
-  server->getConfig()->ban(args["id"].get<steamid_t>());
-  logger::info << "Player " << args["id"].get<steamid_t>() << " banned" << std::endl;
+  steamid_t steamId = steamIdArgument(args);
+  server->getConfig()->ban(steamId);
+  logger::info << "Player " << steamId << " banned" << std::endl;
 }
 
-void UnbanCommand::execute(server_t server, client_t client, json args)
+void UnbanCommand::execute(server_t server, client_t client, json& args)
 {
-  server->getConfig()->unban(args["id"].get<steamid_t>());
-  logger::info << "Player " << args["id"].get<steamid_t>() << " unbanned" << std::endl;
+  steamid_t steamId = steamIdArgument(args);
+  server->getConfig()->unban(steamId);
+  logger::info << "Player " << steamId << " unbanned" << std::endl;
 }
 
-void WhitelistCommand::execute(server_t server, client_t client, json args)
+void WhitelistCommand::execute(server_t server, client_t client, json& args)
 {
   string subcommand = args["on/off/add/remove"].get<string>();
   if (subcommand == "on") {
@@ -144,14 +155,35 @@ void WhitelistCommand::execute(server_t server, client_t client, json args)
     server->getConfig()->setWhitelistEnabled(false);
     logger::info << "Whitelist disabled" << std::endl;
   } else if (subcommand == "add" && args.size() >= 2) {
-    steamid_t steamId = args["id"].get<steamid_t>();
+    steamid_t steamId = steamIdArgument(args);
     server->getConfig()->whitelist(steamId);
     logger::info << "Added player " << steamId << " to whitelist" << std::endl;
   } else if (subcommand == "remove" && args.size() >= 2) {
-    steamid_t steamId = args["id"].get<steamid_t>();
+    steamid_t steamId = steamIdArgument(args);
     server->getConfig()->unwhitelist(steamId);
     logger::info << "Removed player " << steamId << " from whitelist" << std::endl;
   } else {
     logger::info << "Usage: " << this->getUsage() << std::endl;
   }
 }
+
+void NetStatsCommand::execute(server_t server, client_t client, json& args)
+{
+  client_list_t clients = server->getClients();
+  logger::info << clients.size() << " client(s) connected to server" << std::endl;
+  for (client_t c : clients) {
+    logger::info << c->getIdentity() << ": " << c->getQueuedMessages() << " message(s) queued (" << c->getQueuedBytes() << " bytes), stalled for " << c->getStallTime() << "ms, " << c->getDroppedMessages() << " dropped" << std::endl;
+  }
+}
+
+void RequestStatsCommand::execute(server_t server, client_t client, json& args)
+{
+  preq_manager_t requests = server->getPersistentRequestManager();
+  logger::info << requests->getPendingCount() << " persistent request(s) pending" << std::endl;
+  logger::info << "Created: " << requests->getCreatedCount() << ", completed: " << requests->getCompletedCount() << " (" << requests->getPartialCount() << " at their deadline), expired: " << requests->getExpiredCount() << std::endl;
+  for (auto& it : requests->getLatencies()) {
+    std::vector<long>& ms = it.second;
+    if (ms.empty()) continue;
+    logger::info << it.first << " over the last " << ms.size() << ": p50 " << ms[ms.size() * 50 / 100] << "ms, p90 " << ms[ms.size() * 90 / 100] << "ms, p99 " << ms[ms.size() * 99 / 100] << "ms, max " << ms.back() << "ms" << std::endl;
+  }
+}
@@ -5,7 +5,7 @@
 
 using namespace balatrogether;
 
-void HighlightCardEvent::execute(lobby_t lobby, client_t client, json req)
+void HighlightCardEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isCoop()) throw std::runtime_error("Not a co-op game");
   if (!validation::string(req["type"], 1, 32)) throw std::invalid_argument("No card type provided");
@@ -17,7 +17,7 @@ void HighlightCardEvent::execute(lobby_t lobby, client_t client, json req)
   lobby->sendToOthers(client, response::success("HIGHLIGHT", data));
 }
 
-void UnhighlightCardEvent::execute(lobby_t lobby, client_t client, json req)
+void UnhighlightCardEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isCoop()) throw std::runtime_error("Not a co-op game");
   if (!validation::string(req["type"], 1, 32)) throw std::invalid_argument("No card type provided");
@@ -29,28 +29,28 @@ void UnhighlightCardEvent::execute(lobby_t lobby, client_t client, json req)
   lobby->sendToOthers(client, response::success("UNHIGHLIGHT", data));
 }
 
-void UnhighlightAllEvent::execute(lobby_t lobby, client_t client, json req)
+void UnhighlightAllEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isCoop()) throw std::runtime_error("Not a co-op game");
 
   lobby->sendToOthers(client, response::success("UNHIGHLIGHT_ALL"));
 }
 
-void PlayHandEvent::execute(lobby_t lobby, client_t client, json req)
+void PlayHandEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isCoop()) throw std::runtime_error("Not a co-op game");
 
   lobby->broadcast(response::success("PLAY_HAND"));
 }
 
-void DiscardHandEvent::execute(lobby_t lobby, client_t client, json req)
+void DiscardHandEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isCoop()) throw std::runtime_error("Not a co-op game");
 
   lobby->broadcast(response::success("DISCARD_HAND"));
 }
 
-void SortHandEvent::execute(lobby_t lobby, client_t client, json req)
+void SortHandEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isCoop()) throw std::runtime_error("Not a co-op game");
   if (!validation::string(req["type"], 1, 8)) throw std::invalid_argument("No sort type provided");
@@ -62,7 +62,7 @@ void SortHandEvent::execute(lobby_t lobby, client_t client, json req)
   lobby->broadcast(response::success("SORT_HAND", data));
 }
 
-void ReorderCardsEvent::execute(lobby_t lobby, client_t client, json req)
+void ReorderCardsEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isCoop()) throw std::runtime_error("Not a co-op game");
   if (!validation::string(req["type"], 1, 32)) throw std::invalid_argument("No card type provided");
@@ -76,21 +76,21 @@ void ReorderCardsEvent::execute(lobby_t lobby, client_t client, json req)
   lobby->sendToOthers(client, response::success("REORDER", data));
 }
 
-void SelectBlindEvent::execute(lobby_t lobby, client_t client, json req)
+void SelectBlindEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isCoop()) throw std::runtime_error("Not a co-op game");
 
   lobby->broadcast(response::success("SELECT_BLIND"));
 }
 
-void SkipBlindEvent::execute(lobby_t lobby, client_t client, json req)
+void SkipBlindEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isCoop()) throw std::runtime_error("Not a co-op game");
 
   lobby->broadcast(response::success("SKIP_BLIND"));
 }
 
-void SellCardEvent::execute(lobby_t lobby, client_t client, json req)
+void SellCardEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isCoop()) throw std::runtime_error("Not a co-op game");
   if (!validation::string(req["type"], 1, 32)) throw std::invalid_argument("No card type provided");
@@ -102,7 +102,7 @@ void SellCardEvent::execute(lobby_t lobby, client_t client, json req)
   lobby->broadcast(response::success("SELL", data));
 }
 
-void BuyCardEvent::execute(lobby_t lobby, client_t client, json req)
+void BuyCardEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isCoop()) throw std::runtime_error("Not a co-op game");
   if (!validation::string(req["type"], 1, 32)) throw std::invalid_argument("No card type provided");
@@ -114,7 +114,7 @@ void BuyCardEvent::execute(lobby_t lobby, client_t client, json req)
   lobby->broadcast(response::success("BUY", data));
 }
 
-void UseCardEvent::execute(lobby_t lobby, client_t client, json req)
+void UseCardEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isCoop()) throw std::runtime_error("Not a co-op game");
   if (!validation::integer(req["index"], 0)) throw std::invalid_argument("No index provided");
@@ -124,7 +124,7 @@ void UseCardEvent::execute(lobby_t lobby, client_t client, json req)
   lobby->broadcast(response::success("USE", data));
 }
 
-void BuyAndUseCardEvent::execute(lobby_t lobby, client_t client, json req)
+void BuyAndUseCardEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isCoop()) throw std::runtime_error("Not a co-op game");
   if (!validation::integer(req["index"], 0)) throw std::invalid_argument("No index provided");
@@ -134,42 +134,42 @@ void BuyAndUseCardEvent::execute(lobby_t lobby, client_t client, json req)
   lobby->broadcast(response::success("BUY_AND_USE", data));
 }
 
-void SkipBoosterEvent::execute(lobby_t lobby, client_t client, json req)
+void SkipBoosterEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isCoop()) throw std::runtime_error("Not a co-op game");
 
   lobby->broadcast(response::success("SKIP_BOOSTER"));
 }
 
-void RerollEvent::execute(lobby_t lobby, client_t client, json req)
+void RerollEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isCoop()) throw std::runtime_error("Not a co-op game");
 
   lobby->broadcast(response::success("REROLL"));
 }
 
-void NextRoundEvent::execute(lobby_t lobby, client_t client, json req)
+void NextRoundEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isCoop()) throw std::runtime_error("Not a co-op game");
 
   lobby->broadcast(response::success("NEXT_ROUND"));
 }
 
-void GoToShopEvent::execute(lobby_t lobby, client_t client, json req)
+void GoToShopEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isCoop()) throw std::runtime_error("Not a co-op game");
 
   lobby->broadcast(response::success("GO_TO_SHOP"));
 }
 
-void EndlessEvent::execute(lobby_t lobby, client_t client, json req)
+void EndlessEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isCoop()) throw std::runtime_error("Not a co-op game");
 
   lobby->broadcast(response::success("ENDLESS"));
 }
 
-void GameSpeedEvent::execute(lobby_t lobby, client_t client, json req)
+void GameSpeedEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isCoop()) throw std::runtime_error("Not a co-op game");
   if (!validation::integer(req["speed"], 0, 32)) throw std::invalid_argument("Invalid game speed");
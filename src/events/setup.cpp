@@ -8,20 +8,21 @@
 
 using namespace balatrogether;
 
-void connectToServer(server_t server, client_t client, json req) {
+void connectToServer(server_t server, client_t client, json& req) {
   if (!validation::steamid(req["steam_id"])) throw std::invalid_argument("No Steam ID provided");
   if (!validation::string(req["unlock_hash"], 64, 128) || !validation::base64(req["unlock_hash"])) throw std::invalid_argument("No unlock hash provided");
   if (!req["stakes"].is_object() || req["stakes"].size() > 20) throw std::invalid_argument("No stake unlocks provided");
+  if (!req["game_state_diff"].is_null() && !validation::boolean(req["game_state_diff"])) throw std::invalid_argument("Invalid game state option");
 
   player_auth auth;
-  auth.steamId = req["steam_id"].get<steamid_t>();
+  parsesteamid(req["steam_id"].get_ref<const string&>(), auth.steamId);
   auth.unlockHash = req["unlock_hash"].get<string>();
   auth.stakes = req["stakes"].get<std::unordered_map<string, int>>();
-  if (server->getConfig()->isSteamApiEnabled()) auth.fetchKey = server->getConfig()->getSteamApiKey();
+  auth.stateDiff = req["game_state_diff"].is_boolean() && req["game_state_diff"].get<bool>();
   server->connect(client, auth);
 }
 
-void JoinEvent::execute(server_t server, client_t client, json req)
+void JoinEvent::execute(server_t server, client_t client, json& req)
 {
   connectToServer(server, client, req);
   lobby_t defaultLobby = server->getDefaultLobby();
@@ -41,7 +42,7 @@ void JoinEvent::execute(server_t server, client_t client, json req)
   }
 }
 
-void JoinLobbyEvent::execute(server_t server, client_t client, json req)
+void JoinLobbyEvent::execute(server_t server, client_t client, json& req)
 {
   if (server->getDefaultLobby()) throw std::runtime_error("Bad request");
   if (!validation::integer(req["number"], 1, server->getConfig()->getMaxLobbies())) throw std::invalid_argument("No lobby number provided");
@@ -52,7 +53,7 @@ void JoinLobbyEvent::execute(server_t server, client_t client, json req)
   lobby->add(client);
 }
 
-void StartRunEvent::execute(lobby_t lobby, client_t client, json req)
+void StartRunEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!validation::string(req["seed"], 8, 8)) throw std::invalid_argument("No seed provided");
   if (!validation::string(req["deck"], 1, 32)) throw std::invalid_argument("No deck provided");
@@ -8,44 +8,90 @@
 
 using namespace balatrogether;
 
-void SwapJokersEvent::execute(lobby_t lobby, client_t client, json req)
+// Offers the creator's jokers to a random player who has not been asked yet. Returns false if there is nobody left
+static bool askForJokers(lobby_t lobby, preq_t preq)
 {
+  game_t game = lobby->getGame();
+  size_t options = 0;
+  for (size_t slot = 0; slot < game->getPlayerCount(); slot++) {
+    if (!game->isSlotEliminated(slot) && !preq->hasContributed(slot)) options++;
+  }
+  if (options == 0) return false;
+  size_t pick = std::uniform_int_distribution<size_t>(0, options - 1)(game->getRandom());
+  int target = -1;
+  for (size_t slot = 0; slot < game->getPlayerCount(); slot++) {
+    if (game->isSlotEliminated(slot) || preq->hasContributed(slot)) continue;
+    if (pick-- == 0) {
+      target = slot;
+      break;
+    }
+  }
+  preq->contribute(target);
+  preq->setTarget(target);
+
+  json data;
+  data["jokers"] = preq->getJokers();
+  data["request_id"] = std::to_string(preq->getId());
+  lobby->sendToPlayer(game->getPlayer(target)->getClient(), response::success("SWAP_JOKERS", data));
+  lobby->await(preq, PREQ_SWAP_TIMEOUT_MS);
+  return true;
+}
+
+// Gives the creator the jokers of the player they were swapped with, however late that player answers
+static void swapJokersReply(preq_t preq, client_t client, json& req)
+{
+  lobby_t lobby = preq->getLobby();
   if (!lobby->getGame()->isVersus()) throw std::runtime_error("Not a versus game");
   if (!req["jokers"].is_array()) throw std::invalid_argument("No jokers provided");
+  for (json& joker : req["jokers"]) {
+    if (!validation::string(joker["k"], 1, 32)) throw std::invalid_argument("No joker key");
+  }
+  if (lobby->getGame()->getSlot(client->getPlayer()) != preq->getTarget()) return;
 
-  if (req["request_id"].is_string()) {
-    for (json joker : req["jokers"]) {
-      if (!validation::string(joker["k"], 1, 32)) throw std::invalid_argument("No joker key");
-    }
+  json data;
+  data["jokers"] = std::move(req["jokers"]);
+  client_t creator = lobby->getClient(preq->getCreator());
+  if (creator) lobby->sendToPlayer(creator, response::success("SWAP_JOKERS", data));
+  lobby->complete(preq);
+}
 
-    string requestId = req["request_id"].get<string>();
-    preq_t preq = lobby->getServer()->getPersistentRequestManager()->getById(requestId);
-    if (!preq) return;
+// Keeps waiting on a target still in the run for up to PREQ_SWAP_WAIT_MS, otherwise retargets or returns the jokers
+static void swapJokersTimeout(preq_t preq)
+{
+  lobby_t lobby = preq->getLobby();
+  game_t game = lobby->getGame();
+  bool waiting = game->isVersus() && !game->isSlotEliminated(preq->getTarget());
+  if (waiting && preq->getAge() < PREQ_SWAP_WAIT_MS) {
+    lobby->await(preq, PREQ_SWAP_TIMEOUT_MS);
+    return;
+  }
+  if (!waiting && game->isVersus() && askForJokers(lobby, preq)) return;
 
+  client_t creator = lobby->getClient(preq->getCreator());
+  if (creator && lobby->getGame()->isVersus()) {
     json data;
-    data["jokers"] = req["jokers"];
-    for (client_t client : lobby->getClients()) {
-      if (client->getPlayer()->getSteamId() == preq->getCreator()) {
-        lobby->sendToPlayer(client, response::success("SWAP_JOKERS", data));
-        break;
-      }
-    }
-    lobby->getServer()->getPersistentRequestManager()->complete(requestId);
-  } else {
-    for (json joker : req["jokers"]) {
-      if (!validation::string(joker["k"], 1, 32)) throw std::invalid_argument("No joker key");
-    }
+    data["jokers"] = std::move(preq->getJokers());
+    lobby->sendToPlayer(creator, response::success("SWAP_JOKERS", data));
+  }
+  lobby->complete(preq);
+}
 
-    preq_t preq = lobby->getServer()->getPersistentRequestManager()->create(client->getPlayer()->getSteamId());
-    json data;
-    data["jokers"] = req["jokers"];
-    data["request_id"] = preq->getId();
-    player_t randomPlayer = lobby->getGame()->getRandomPlayer(client->getPlayer());
-    if (randomPlayer) lobby->sendToPlayer(randomPlayer->getClient(), response::success("SWAP_JOKERS", data));
+void SwapJokersEvent::execute(lobby_t lobby, client_t client, json& req)
+{
+  if (!lobby->getGame()->isVersus()) throw std::runtime_error("Not a versus game");
+  if (!req["jokers"].is_array()) throw std::invalid_argument("No jokers provided");
+  for (json& joker : req["jokers"]) {
+    if (!validation::string(joker["k"], 1, 32)) throw std::invalid_argument("No joker key");
   }
+
+  preq_t preq = lobby->ask(this->getCommand(), client, swapJokersReply, swapJokersTimeout);
+  preq->contribute(lobby->getGame()->getSlot(client->getPlayer()));
+  std::vector<json>& jokers = preq->getJokers();
+  for (json& joker : req["jokers"]) jokers.push_back(std::move(joker));
+  if (!askForJokers(lobby, preq)) lobby->complete(preq);
 }
 
-void GreenSealEvent::execute(lobby_t lobby, client_t client, json req)
+void GreenSealEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isVersus()) throw std::runtime_error("Not a versus game");
 
@@ -54,7 +100,7 @@ void GreenSealEvent::execute(lobby_t lobby, client_t client, json req)
   lobby->sendToOthers(client, response::success("MONEY", data));
 }
 
-void EraserEvent::execute(lobby_t lobby, client_t client, json req)
+void EraserEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isVersus()) throw std::runtime_error("Not a versus game");
 
@@ -64,7 +110,7 @@ void EraserEvent::execute(lobby_t lobby, client_t client, json req)
   if (randomPlayer) lobby->sendToPlayer(randomPlayer->getClient(), response::success("HAND_SIZE", data));
 }
 
-void PaintBucketEvent::execute(lobby_t lobby, client_t client, json req)
+void PaintBucketEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isVersus()) throw std::runtime_error("Not a versus game");
 
@@ -73,71 +119,74 @@ void PaintBucketEvent::execute(lobby_t lobby, client_t client, json req)
   lobby->sendToOthers(client, response::success("HAND_SIZE", data));
 }
 
-void GetCardsAndJokersEvent::execute(lobby_t lobby, client_t client, json req)
+// Sends the creator every joker that was collected and the sampled cards, then retires the request
+static void finishCardsAndJokers(preq_t preq)
 {
-  if (!lobby->getGame()->isVersus()) throw std::runtime_error("Not a versus game");
+  lobby_t lobby = preq->getLobby();
+  json results;
+  results["jokers"] = json::array();
+  results["cards"] = json::array();
+  for (json& joker : preq->getJokers()) results["jokers"].push_back(std::move(joker));
+  for (json& card : preq->drawCards(lobby->getGame()->getRandom())) results["cards"].push_back(std::move(card));
+  client_t creator = lobby->getClient(preq->getCreator());
+  if (creator) lobby->sendToPlayer(creator, response::success("GET_CARDS_AND_JOKERS", results));
+  lobby->complete(preq);
+}
 
-  if (req["request_id"].is_string()) {
-    if (!req["jokers"].is_array()) throw std::invalid_argument("No jokers provided");
-    if (!req["cards"].is_array()) throw std::invalid_argument("No cards provided");
+// Collects one player's cards and jokers, replying once every remaining player has sent theirs
+static void cardsAndJokersReply(preq_t preq, client_t client, json& req)
+{
+  lobby_t lobby = preq->getLobby();
+  game_t game = lobby->getGame();
+  if (!game->isVersus()) throw std::runtime_error("Not a versus game");
+  if (!req["jokers"].is_array()) throw std::invalid_argument("No jokers provided");
+  if (!req["cards"].is_array()) throw std::invalid_argument("No cards provided");
 
-    string requestId = req["request_id"].get<string>();
-    preq_t preq = lobby->getServer()->getPersistentRequestManager()->getById(requestId);
-    if (!preq) return;
+  int slot = game->getSlot(client->getPlayer());
+  if (slot < 0 || preq->hasContributed(slot)) return;
+  for (json& joker : req["jokers"]) {
+    if (!validation::string(joker["k"], 1, 32)) throw std::invalid_argument("No joker key");
+  }
+  for (json& card : req["cards"]) {
+    if (!validation::string(card["k"], 1, 32)) throw std::invalid_argument("No card key");
+  }
+  preq->contribute(slot);
+  std::vector<json>& jokers = preq->getJokers();
+  for (json& joker : req["jokers"]) jokers.push_back(std::move(joker));
+  for (json& card : req["cards"]) preq->addCard(card, game->getRandom());
 
-    json preqData = preq->getData();
-    if (preqData["contributed"][client->getPlayer()->getSteamId()].get<bool>()) return;
-    for (json joker : req["jokers"]) {
-      if (!validation::string(joker["k"], 1, 32)) throw std::invalid_argument("No joker key");
-      preqData["results"]["jokers"].push_back(joker);
-    }
-    for (json card : req["cards"]) {
-      if (!validation::string(card["k"], 1, 32)) throw std::invalid_argument("No card key");
-      preqData["results"]["cards"].push_back(card);
-    }
-    preqData["contributed"][client->getPlayer()->getSteamId()] = true;
-    preq->setData(preqData);
+  if (preq->isComplete(game)) finishCardsAndJokers(preq);
+}
 
-    for (player_t p : lobby->getGame()->getRemaining()) {
-      if (!preqData["contributed"][p->getSteamId()].get<bool>()) return;
-    }
-    json randomCards = json::array();
-    for (int i = 0; i < 20; i++) {
-      if (preqData["results"]["cards"].size() == 0) break;
-      size_t cardIndex = rand() % preqData["results"]["cards"].size();
-      randomCards.push_back(preqData["results"]["cards"].at(cardIndex));
-      preqData["results"]["cards"].erase(cardIndex);
-    }
-    preqData["results"]["cards"] = randomCards;
-    for (client_t client : lobby->getClients()) {
-      if (client->getPlayer()->getSteamId() == preq->getCreator()) {
-        lobby->sendToPlayer(client, response::success("GET_CARDS_AND_JOKERS", preqData["results"]));
-        break;
-      }
-    }
-    lobby->getServer()->getPersistentRequestManager()->complete(preq->getId());
+// Replies with whatever has been collected once the slowest players have had their time
+static void cardsAndJokersTimeout(preq_t preq)
+{
+  if (preq->getLobby()->getGame()->isVersus()) {
+    finishCardsAndJokers(preq);
   } else {
-    preq_t preq = lobby->getServer()->getPersistentRequestManager()->create(client->getPlayer()->getSteamId());
-    json preqData;
-    preqData["contributed"] = json::object();
-    preqData["contributed"][client->getPlayer()->getSteamId()] = true;
-    preqData["results"] = json::object();
-    preqData["results"]["jokers"] = json::array();
-    preqData["results"]["cards"] = json::array();
-    preq->setData(preqData);
+    preq->getLobby()->complete(preq);
+  }
+}
 
-    json data;
-    data["request_id"] = preq->getId();
-    lobby->sendToOthers(client, response::success("GET_CARDS_AND_JOKERS", data), true);
-    for (player_t p : lobby->getGame()->getRemaining()) {
-      if (!preqData["contributed"][p->getSteamId()].get<bool>()) return;
-    }
-    lobby->sendToPlayer(client, response::success("GET_CARDS_AND_JOKERS", preqData["results"]));
-    lobby->getServer()->getPersistentRequestManager()->complete(preq->getId());
+void GetCardsAndJokersEvent::execute(lobby_t lobby, client_t client, json& req)
+{
+  if (!lobby->getGame()->isVersus()) throw std::runtime_error("Not a versus game");
+  game_t game = lobby->getGame();
+
+  preq_t preq = lobby->ask(this->getCommand(), client, cardsAndJokersReply, cardsAndJokersTimeout);
+  preq->contribute(game->getSlot(client->getPlayer()));
+
+  json data;
+  data["request_id"] = std::to_string(preq->getId());
+  lobby->sendToOthers(client, response::success("GET_CARDS_AND_JOKERS", data), true);
+  if (preq->isComplete(game)) {
+    finishCardsAndJokers(preq);
+  } else {
+    lobby->await(preq, PREQ_CARDS_TIMEOUT_MS);
   }
 }
 
-void ReadyForBossEvent::execute(lobby_t lobby, client_t client, json req)
+void ReadyForBossEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isVersus()) throw std::runtime_error("Not a versus game");
 
@@ -148,12 +197,12 @@ void ReadyForBossEvent::execute(lobby_t lobby, client_t client, json req)
   }
 }
 
-void EliminatedEvent::execute(lobby_t lobby, client_t client, json req)
+void EliminatedEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isVersus()) throw std::runtime_error("Not a versus game");
 
   lobby->getGame()->eliminate(client->getPlayer());
-  if (lobby->getGame()->getRemaining().size() == 1) {
+  if (lobby->getGame()->getRemainingCount() == 1) {
     client_t winner = lobby->getClients().at(0);
     lobby->getGame()->reset();
     lobby->sendToPlayer(winner, response::success("WIN"));
@@ -162,7 +211,7 @@ void EliminatedEvent::execute(lobby_t lobby, client_t client, json req)
   }
 }
 
-void DefeatedBossEvent::execute(lobby_t lobby, client_t client, json req)
+void DefeatedBossEvent::execute(lobby_t lobby, client_t client, json& req)
 {
   if (!lobby->getGame()->isVersus()) throw std::runtime_error("Not a versus game");
   if (validation::decimal(req["score"], 0)) throw std::runtime_error("No score provided");
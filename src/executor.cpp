@@ -0,0 +1,166 @@
+#include "util/logs.hpp"
+#include "executor.hpp"
+#include "lobby.hpp"
+
+using namespace balatrogether;
+
+// Starts the workers. A steal threshold of zero pins every lobby to the worker it was assigned
+LobbyExecutor::LobbyExecutor(int threads, int stealThreshold) : next(0), running(true)
+{
+  this->stealThreshold = stealThreshold;
+  for (int i = 0; i < threads; i++) {
+    this->workers.push_back(new worker);
+  }
+  for (int i = 0; i < threads; i++) {
+    this->workers[i]->thread = std::thread(&LobbyExecutor::loop, this, i);
+  }
+  logger::info << "Lobby executor started with " << threads << " worker(s)" << std::endl;
+}
+
+LobbyExecutor::~LobbyExecutor()
+{
+  this->stop();
+  for (worker *w : this->workers) {
+    if (w->thread.joinable()) w->thread.join();
+    delete w;
+  }
+}
+
+// Gives a new lobby its initial owner in round-robin order
+void LobbyExecutor::assign(lobby_t lobby)
+{
+  lobby->setWorker(this->next++ % this->workers.size());
+}
+
+// Queues a request on the lobby, scheduling the lobby on its owner if it was idle
+void LobbyExecutor::submit(lobby_t lobby, client_t client, json req)
+{
+  if (lobby->post(client, std::move(req))) this->schedule(lobby);
+}
+
+// Schedules the lobby once the given time has passed. Its owner is woken in case it is sleeping until a later timer
+void LobbyExecutor::wake(lobby_t lobby, std::chrono::steady_clock::time_point when)
+{
+  {
+    std::lock_guard<std::mutex> guard(this->timerMutex);
+    this->timers.push(timer(when, lobby));
+  }
+  worker *w = this->workers[lobby->getWorker()];
+  std::lock_guard<std::mutex> guard(w->mutex);
+  w->ready.notify_one();
+}
+
+// Wakes every worker so that they return once their current lobby is done
+void LobbyExecutor::stop()
+{
+  this->running = false;
+  for (worker *w : this->workers) {
+    std::lock_guard<std::mutex> guard(w->mutex);
+    w->ready.notify_all();
+  }
+}
+
+// Appends the lobby to its owner's run queue. Once the queue reaches the steal threshold another worker is woken
+// so that it can take some of the backlog
+void LobbyExecutor::schedule(lobby_t lobby)
+{
+  int index = lobby->getWorker();
+  worker *w = this->workers[index];
+  size_t depth;
+  {
+    std::lock_guard<std::mutex> guard(w->mutex);
+    w->queue.push_back(lobby);
+    depth = w->queue.size();
+  }
+  w->ready.notify_one();
+
+  size_t count = this->workers.size();
+  if (this->stealThreshold > 0 && count > 1 && depth >= (size_t) this->stealThreshold) {
+    worker *idle = this->workers[(index + 1 + this->next++ % (count - 1)) % count];
+    std::lock_guard<std::mutex> guard(idle->mutex);
+    idle->ready.notify_one();
+  }
+}
+
+// Returns the next lobby for the worker to run, stealing one if its own queue is empty. Returns nullptr once the
+// executor has stopped
+lobby_t LobbyExecutor::take(int index)
+{
+  worker *w = this->workers[index];
+  std::chrono::steady_clock::time_point next;
+  while (this->running) {
+    this->fire(next);
+    {
+      std::lock_guard<std::mutex> guard(w->mutex);
+      if (!w->queue.empty()) {
+        lobby_t lobby = w->queue.front();
+        w->queue.pop_front();
+        return lobby;
+      }
+    }
+    lobby_t stolen = this->steal(index);
+    if (stolen) return stolen;
+
+    std::unique_lock<std::mutex> lock(w->mutex);
+    if (!w->queue.empty() || !this->running) continue;
+    if (next == std::chrono::steady_clock::time_point::max()) {
+      w->ready.wait(lock);
+    } else {
+      w->ready.wait_until(lock, next);
+    }
+  }
+  return nullptr;
+}
+
+// Schedules every lobby whose timer is due, and sets next to when the earliest remaining timer is
+void LobbyExecutor::fire(std::chrono::steady_clock::time_point& next)
+{
+  std::vector<lobby_t> due;
+  {
+    std::lock_guard<std::mutex> guard(this->timerMutex);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    while (!this->timers.empty() && this->timers.top().first <= now) {
+      due.push_back(this->timers.top().second);
+      this->timers.pop();
+    }
+    next = this->timers.empty() ? std::chrono::steady_clock::time_point::max() : this->timers.top().first;
+  }
+  for (lobby_t lobby : due) {
+    if (lobby->poke()) this->schedule(lobby);
+  }
+}
+
+// Takes the most recently scheduled lobby from the worker with the longest queue, if that queue has reached the
+// steal threshold. The lobby stays with its new owner afterwards
+lobby_t LobbyExecutor::steal(int index)
+{
+  if (this->stealThreshold <= 0) return nullptr;
+  worker *victim = nullptr;
+  size_t longest = 0;
+  for (size_t i = 0; i < this->workers.size(); i++) {
+    if ((int) i == index) continue;
+    std::lock_guard<std::mutex> guard(this->workers[i]->mutex);
+    if (this->workers[i]->queue.size() > longest) {
+      longest = this->workers[i]->queue.size();
+      victim = this->workers[i];
+    }
+  }
+  if (!victim || longest < (size_t) this->stealThreshold) return nullptr;
+
+  std::lock_guard<std::mutex> guard(victim->mutex);
+  if (victim->queue.size() < (size_t) this->stealThreshold) return nullptr;
+  lobby_t lobby = victim->queue.back();
+  victim->queue.pop_back();
+  lobby->setWorker(index);
+  return lobby;
+}
+
+// Runs a batch of each scheduled lobby's requests at a time, putting lobbies with more queued at the back
+void LobbyExecutor::loop(int index)
+{
+  while (this->running) {
+    lobby_t lobby = this->take(index);
+    if (!lobby) break;
+    if (lobby->run(EXECUTOR_BATCH)) this->schedule(lobby);
+  }
+}
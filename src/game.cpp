@@ -2,10 +2,15 @@
 
 using namespace balatrogether;
 
-Game::Game()
+Game::Game() : random(std::random_device()())
 {
-  this->setState(NOT_RUNNING);
+  this->version = 1;
+  this->cachedVersion = 0;
+  this->state = NOT_RUNNING;
   this->versus = false;
+  this->eliminatedCount = 0;
+  this->readyCount = 0;
+  this->scoredCount = 0;
 }
 
 bool Game::isRunning()
@@ -26,17 +31,41 @@ bool Game::isCoop()
 void Game::reset()
 {
   this->setState(NOT_RUNNING);
+  for (player_t p : this->players) {
+    p->slot = -1;
+  }
   this->players.clear();
-  this->readyForBoss.clear();
   this->eliminated.clear();
+  this->readyForBoss.clear();
+  this->scored.clear();
   this->scores.clear();
+  this->scoreOrder.clear();
+  this->eliminationOrder.clear();
+  this->eliminatedCount = 0;
+  this->readyCount = 0;
+  this->scoredCount = 0;
+  this->changed();
 }
 
+// Starts a run, giving each player the slot matching their position in the list
 void Game::start(player_list_t players, bool versus)
 {
   this->setState(IN_PROGRESS);
   this->versus = versus;
   this->players = players;
+  for (size_t i = 0; i < players.size(); i++) {
+    players[i]->slot = i;
+  }
+  this->eliminated.assign(players.size(), false);
+  this->readyForBoss.assign(players.size(), false);
+  this->scored.assign(players.size(), false);
+  this->scores.assign(players.size(), 0);
+  this->scoreOrder.clear();
+  this->eliminationOrder.clear();
+  this->eliminatedCount = 0;
+  this->readyCount = 0;
+  this->scoredCount = 0;
+  this->changed();
 }
 
 player_list_t Game::getPlayers()
@@ -44,11 +73,17 @@ player_list_t Game::getPlayers()
   return this->players;
 }
 
+size_t Game::getPlayerCount()
+{
+  return this->players.size();
+}
+
 player_list_t Game::getRemaining()
 {
   player_list_t remaining;
-  for (player_t p : this->getPlayers()) {
-    if (!this->isEliminated(p)) remaining.push_back(p);
+  remaining.reserve(this->getRemainingCount());
+  for (size_t i = 0; i < this->players.size(); i++) {
+    if (!this->eliminated[i]) remaining.push_back(this->players[i]);
   }
   return remaining;
 }
@@ -56,27 +91,45 @@ player_list_t Game::getRemaining()
 player_list_t Game::getEliminated()
 {
   player_list_t eliminated;
-  for (player_t p : this->getPlayers()) {
-    if (this->isEliminated(p)) eliminated.push_back(p);
+  eliminated.reserve(this->eliminatedCount);
+  for (size_t i = 0; i < this->players.size(); i++) {
+    if (this->eliminated[i]) eliminated.push_back(this->players[i]);
   }
   return eliminated;
 }
 
+size_t Game::getRemainingCount()
+{
+  return this->players.size() - this->eliminatedCount;
+}
+
+size_t Game::getEliminatedCount()
+{
+  return this->eliminatedCount;
+}
+
 player_t Game::getRandomPlayer()
 {
-  player_list_t options = this->getRemaining();
-  if (options.size() == 0) return nullptr;
-  return options.at(rand() % options.size());
+  return this->getRandomPlayer(nullptr);
 }
 
+// Picks a remaining player other than the excluded one, without building a list of candidates
 player_t Game::getRandomPlayer(player_t exclude)
 {
-  player_list_t options;
-  for (player_t p : this->getRemaining()) {
-    if (p->getSteamId() != exclude->getSteamId()) options.push_back(p);
+  int skip = exclude ? this->getSlot(exclude) : -1;
+  size_t options = this->getRemainingCount() - (skip >= 0 && !this->eliminated[skip] ? 1 : 0);
+  if (options == 0) return nullptr;
+  size_t pick = std::uniform_int_distribution<size_t>(0, options - 1)(this->random);
+  for (size_t i = 0; i < this->players.size(); i++) {
+    if (this->eliminated[i] || (int) i == skip) continue;
+    if (pick-- == 0) return this->players[i];
   }
-  if (options.size() == 0) return nullptr;
-  return options.at(rand() % options.size());
+  return nullptr;
+}
+
+std::mt19937& Game::getRandom()
+{
+  return this->random;
 }
 
 game_state_t Game::getState()
@@ -86,97 +139,133 @@ game_state_t Game::getState()
 
 void Game::setState(game_state_t state)
 {
+  if (this->state == state) return;
   this->state = state;
+  this->changed();
 }
 
 bool Game::isEliminated(player_t p)
 {
-  return this->eliminated.find(p) != this->eliminated.end();
+  return this->isSlotEliminated(this->getSlot(p));
+}
+
+bool Game::isSlotEliminated(int slot)
+{
+  return slot >= 0 && (size_t) slot < this->players.size() && this->eliminated[slot];
 }
 
+// Eliminates a player, discarding their score and boss readiness so the counts only cover remaining players
 void Game::eliminate(player_t p)
 {
   if (!this->isVersus()) return;
-  if (this->isEliminated(p)) return;
-  this->eliminated.insert(p);
-  for (int i = 0; i < this->scores.size(); i++) {
-    score_t pair = this->scores[i];
-    if (pair.first == p) {
-      this->scores.erase(this->scores.begin() + i);
-      break;
-    }
+  int slot = this->getSlot(p);
+  if (slot < 0 || this->eliminated[slot]) return;
+  this->eliminated[slot] = true;
+  this->eliminatedCount++;
+  this->eliminationOrder.push_back(slot);
+  this->changed();
+  if (this->readyForBoss[slot]) {
+    this->readyForBoss[slot] = false;
+    this->readyCount--;
+  }
+  if (this->scored[slot]) {
+    this->scored[slot] = false;
+    this->scoredCount--;
   }
 }
 
 bool Game::isBossReady()
 {
-  for (player_t p : this->getRemaining()) {
-    if (this->readyForBoss.find(p) == this->readyForBoss.end()) return false;
-  }
-  return true;
+  return this->readyCount == this->getRemainingCount();
 }
 
 void Game::prepareForBoss(player_t p)
 {
   if (!this->isVersus()) return;
   if (this->getState() != IN_PROGRESS && this->getState() != WAITING_FOR_BOSS) return;
-  if (this->readyForBoss.find(p) != this->readyForBoss.end()) return;
+  int slot = this->getSlot(p);
+  if (slot < 0 || this->readyForBoss[slot]) return;
   this->setState(WAITING_FOR_BOSS);
-  this->readyForBoss.insert(p);
+  if (this->eliminated[slot]) return;
+  this->readyForBoss[slot] = true;
+  this->readyCount++;
 }
 
 bool Game::isScoringFinished()
 {
   if (this->getState() != WAITING_FOR_LEADERBOARD) return false;
-  for (player_t p : this->getRemaining()) {
-    bool hasScored = false;
-    for (score_t score : this->scores) {
-      if (score.first == p) {
-        hasScored = true;
-        break;
-      }
-    }
-    if (!hasScored) return false;
-  }
-  return true;
+  return this->scoredCount == this->getRemainingCount();
 }
 
+// Lists scores in the order they arrived, followed by eliminated players, most recently eliminated first
 json Game::getLeaderboard()
 {
   json leaderboard = json::array();
-  for (score_t pair : this->scores) {
+  for (int slot : this->scoreOrder) {
+    if (!this->scored[slot]) continue;
     json row;
-    row["player"] = pair.first->getSteamId();
-    row["score"] = pair.second;
+    row["player"] = std::to_string(this->players[slot]->getSteamId());
+    row["score"] = this->scores[slot];
     leaderboard.push_back(row);
   }
-  player_list_t eliminatedPlayers = this->getEliminated();
-  std::reverse(eliminatedPlayers.begin(), eliminatedPlayers.end());
-  for (player_t eliminated : eliminatedPlayers) {
+  for (auto it = this->eliminationOrder.rbegin(); it != this->eliminationOrder.rend(); it++) {
     json row;
-    row["player"] = eliminated->getSteamId();
+    row["player"] = std::to_string(this->players[*it]->getSteamId());
     leaderboard.push_back(row);
   }
   return leaderboard;
 }
 
+// Records a remaining player's score. Only the first score each player sends counts
 void Game::addScore(player_t p, double score)
 {
   if (!this->isVersus()) return;
   if (this->getState() != FIGHTING_BOSS && this->getState() != WAITING_FOR_LEADERBOARD) return;
-  for (score_t score : this->scores) {
-    if (score.first == p) return;
-  }
+  int slot = this->getSlot(p);
+  if (slot < 0 || this->eliminated[slot] || this->scored[slot]) return;
   this->setState(WAITING_FOR_LEADERBOARD);
-  this->scores.push_back(score_t(p, score));
+  this->scored[slot] = true;
+  this->scores[slot] = score;
+  this->scoredCount++;
+  this->scoreOrder.push_back(slot);
 }
 
-json Game::getJSON() 
+uint64_t Game::getVersion()
 {
-  json data = {
-    {"state", this->getState()},
-    {"remaining", this->getRemaining().size()},
-    {"eliminated", this->getEliminated().size()}
-  };
-  return data;
-}
\ No newline at end of file
+  return this->version;
+}
+
+const json& Game::getJSON()
+{
+  if (this->cachedVersion != this->version) {
+    this->cached = {
+      {"state", this->getState()},
+      {"remaining", this->getRemainingCount()},
+      {"eliminated", this->getEliminatedCount()}
+    };
+    this->cachedVersion = this->version;
+  }
+  return this->cached;
+}
+
+// Returns the player's slot in this run, or -1 if they are not part of it
+int Game::getSlot(player_t p)
+{
+  if (!p) return -1;
+  int slot = p->slot;
+  if (slot < 0 || slot >= (int) this->players.size() || this->players[slot] != p) return -1;
+  return slot;
+}
+
+// Returns the player in the given slot, or nullptr if there is none
+player_t Game::getPlayer(int slot)
+{
+  if (slot < 0 || slot >= (int) this->players.size()) return nullptr;
+  return this->players[slot];
+}
+
+// Marks the state sent to clients as changed. Versions are never reused, even across runs
+void Game::changed()
+{
+  this->version++;
+}
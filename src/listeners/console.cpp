@@ -12,6 +12,8 @@ ConsoleEventListener::ConsoleEventListener(server_t server) : EventListener(serv
   this->add(new BanCommand);
   this->add(new UnbanCommand);
   this->add(new WhitelistCommand);
+  this->add(new NetStatsCommand);
+  this->add(new RequestStatsCommand);
 
   logger::info << "Console commands registered" << std::endl;
 }
@@ -71,6 +73,6 @@ bool ConsoleEventListener::process(string line)
   return false;
 }
 
-void ConsoleEventListener::client_error(server_t server, client_t client, json req, client_exception& e) {
+void ConsoleEventListener::client_error(server_t server, client_t client, json& req, client_exception& e) {
   return;
 }
\ No newline at end of file
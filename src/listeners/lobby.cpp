@@ -3,10 +3,12 @@
 #include "events/setup.hpp"
 #include "events/coop.hpp"
 #include "events/versus.hpp"
+#include "lobby.hpp"
 
 using namespace balatrogether;
 
-LobbyEventListener::LobbyEventListener(lobby_t lobby) : EventListener(lobby)
+// Registers the lobby events once for the whole server. Every lobby dispatches through this listener
+LobbyEventListener::LobbyEventListener() : EventListener(nullptr)
 {
   this->add(new StartRunEvent);
 
@@ -39,10 +41,15 @@ LobbyEventListener::LobbyEventListener(lobby_t lobby) : EventListener(lobby)
   this->add(new EliminatedEvent);
   this->add(new DefeatedBossEvent);
 
-  lobby->getLogger() << "Listening for lobby events" << std::endl;
+  logger::info << "Listening for lobby events" << std::endl;
 }
 
-void LobbyEventListener::client_error(lobby_t lobby, client_t client, json req, client_exception &e)
+bool LobbyEventListener::resume(lobby_t lobby, client_t client, json& req)
+{
+  return lobby->resume(client, req);
+}
+
+void LobbyEventListener::client_error(lobby_t lobby, client_t client, json& req, client_exception &e)
 {
   lobby->getServer()->getNetworkManager()->send({client}, response::error(e.what()));
 }
\ No newline at end of file
@@ -12,7 +12,7 @@ ServerEventListener::ServerEventListener(server_t server) : EventListener(server
   logger::info << "Listening for client events" << std::endl;
 }
 
-void ServerEventListener::client_error(server_t server, client_t client, json req, client_exception &e)
+void ServerEventListener::client_error(server_t server, client_t client, json& req, client_exception &e)
 {
   server->getNetworkManager()->send({client}, response::error(e.what()));
 }
\ No newline at end of file
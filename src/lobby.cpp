@@ -2,31 +2,26 @@
 #include "lobby.hpp"
 #include "server.hpp"
 #include "client.hpp"
+#include "executor.hpp"
 
 using namespace balatrogether;
 
-Lobby::Lobby(server_t server, int roomNumber) : logger(string("[INFO] [ROOM ") + std::to_string(roomNumber) + "] ", std::cout)
+Lobby::Lobby(server_t server, int roomNumber) : scheduled(false), worker(0)
 {
   this->roomNumber = roomNumber;
   this->server = server;
-  this->listener = new LobbyEventListener(this);
-  this->game = new Game;
-  this->getLogger() << "Lobby initialization complete" << std::endl;
 }
 
 Lobby::~Lobby() 
 {
-  delete this->listener;
-  delete this->game;
 }
 
 bool Lobby::canJoin(client_t client)
 {
+  std::lock_guard<std::recursive_mutex> guard(this->mutex);
   if (this->getGame()->isRunning()) return false;
-  if (this->getServer()->getConfig()->getMaxPlayers() <= this->getClients().size()) return false;
-  for (client_t c : this->getClients()) {
-    if (client->getIdentity() == c->getIdentity()) return false;
-  }
+  if (this->getServer()->getConfig()->getMaxPlayers() <= this->clients.size()) return false;
+  if (client->getPlayer() && this->members.count(client->getPlayer()->getSteamId())) return false;
   return true;
 }
 
@@ -42,35 +37,57 @@ client_t Lobby::getHost()
 
 void Lobby::sendToPlayer(client_t client, json payload)
 {
-  payload["game_state"] = this->getGame()->getJSON();
-  this->getServer()->getNetworkManager()->send({client}, payload);
+  this->send({client}, payload);
 }
 
 void Lobby::sendToOthers(client_t client, json payload, bool ignoreEliminated)
 {
-  payload["game_state"] = this->getGame()->getJSON();
   client_list_t clients;
   for (client_t c : this->getClients()) {
     if (client != c && (!ignoreEliminated || !this->getGame()->isEliminated(c->getPlayer()))) clients.push_back(c);
   }
-  this->getServer()->getNetworkManager()->send(clients, payload);
+  this->send(clients, payload);
 }
 
 void Lobby::broadcast(json payload, bool ignoreEliminated)
 {
-  payload["game_state"] = this->getGame()->getJSON();
   client_list_t clients;
   for (client_t c : this->getClients()) {
     if (!ignoreEliminated || !this->getGame()->isEliminated(c->getPlayer())) clients.push_back(c);
   }
-  this->getServer()->getNetworkManager()->send(clients, payload);
+  this->send(clients, payload);
+}
+
+// Sends a payload with the game state attached for every receiver whose state is out of date
+void Lobby::send(const client_list_t& clients, json& payload)
+{
+  network_t network = this->getServer()->getNetworkManager();
+  uint64_t version = this->getGame()->getVersion();
+  bool cosmetic = network->isCosmetic(payload);
+  client_list_t current, stale;
+  for (client_t c : clients) {
+    player_t p = c->getPlayer();
+    if (p && p->auth.stateDiff && p->stateVersion == version) {
+      current.push_back(c);
+      continue;
+    }
+    stale.push_back(c);
+    if (p && !cosmetic) p->stateVersion = version;
+  }
+  network->send(current, payload);
+  if (stale.empty()) return;
+  payload["game_state"] = this->getGame()->getJSON();
+  network->send(stale, payload);
 }
 
+// Membership changes hold both the server lock and the lobby lock, so the client list may be read under either
 void Lobby::add(client_t client)
 {
+  std::lock_guard<std::recursive_mutex> guard(this->mutex);
   if (!client->getPlayer()) return;
   if (!this->canJoin(client)) throw client_exception("Cannot join lobby");
   this->clients.push_back(client);
+  this->members[client->getPlayer()->getSteamId()] = client;
   client->setLobby(this);
   this->getLogger() << "Player " << client->getPlayer()->getSteamId() << " joined lobby" << std::endl;
   this->broadcast(response::success("JOIN", this->getJSON()));
@@ -78,12 +95,14 @@ void Lobby::add(client_t client)
 
 void Lobby::remove(client_t client)
 {
+  std::lock_guard<std::recursive_mutex> guard(this->mutex);
   this->getLogger() << "Player " << client->getPlayer()->getSteamId() << " left lobby" << std::endl;
   this->getGame()->eliminate(client->getPlayer());
   for (int i = 0; i < this->clients.size(); i++) {
     client_t c = this->clients.at(i);
     if (c == client) {
       this->clients.erase(this->clients.begin() + i);
+      this->members.erase(client->getPlayer()->getSteamId());
       client->setLobby(nullptr);
       this->broadcast(response::success("LEAVE", this->getJSON()));
       break;
@@ -94,12 +113,139 @@ void Lobby::remove(client_t client)
 
 void Lobby::close()
 {
+  std::lock_guard<std::recursive_mutex> guard(this->mutex);
   this->getGame()->reset();
   for (client_t c : this->getClients()) {
     this->getServer()->disconnect(c);
   }
 }
 
+// Locks the lobby's game state, always after the server lock when both are needed
+void Lobby::lock()
+{
+  this->mutex.lock();
+}
+
+void Lobby::unlock()
+{
+  this->mutex.unlock();
+}
+
+// Queues a request from one of the lobby's clients. Returns true if the lobby was idle and has to be scheduled
+bool Lobby::post(client_t client, json req)
+{
+  client->ref();
+  request r;
+  r.client = client;
+  r.req = std::move(req);
+  this->inbox.push(std::move(r));
+  return !this->scheduled.exchange(true);
+}
+
+// Schedules the lobby to check for expired deadlines. Returns true if the lobby was idle and has to be scheduled
+bool Lobby::poke()
+{
+  return !this->scheduled.exchange(true);
+}
+
+// Runs up to limit queued requests in order. Returns true if the lobby has to be scheduled again
+bool Lobby::run(size_t limit)
+{
+  size_t count = 0;
+  request r;
+  this->lock();
+  this->expire();
+  while (count < limit && this->inbox.pop(r)) {
+    client_t c = r.client;
+    bool success = true;
+    if (!c->isClosed() && c->getLobby() == this) success = this->getEventListener()->process(this, c, r.req);
+    if (!success) c->close();
+    c->unref();
+    count++;
+  }
+  this->unlock();
+  if (count == limit) return true;
+
+  this->scheduled = false;
+  return !this->inbox.empty() && !this->scheduled.exchange(true);
+}
+
+// Creates a pending request from one of the lobby's players, resumed by its reply and timeout continuations
+preq_t Lobby::ask(string command, client_t creator, preq_reply_t onReply, preq_timeout_t onTimeout)
+{
+  std::lock_guard<std::recursive_mutex> guard(this->mutex);
+  preq_t preq = this->getServer()->getPersistentRequestManager()->create(command, creator->getPlayer()->getSteamId(), this, onReply, onTimeout);
+  this->requests[preq->getId()] = preq;
+  return preq;
+}
+
+// Waits on a pending request until timeoutMs from now, replacing any earlier deadline
+void Lobby::await(preq_t preq, int timeoutMs)
+{
+  std::lock_guard<std::recursive_mutex> guard(this->mutex);
+  if (!this->requests.count(preq->getId())) return;
+  preq->timedOut = false;
+  preq->deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+  this->deadlines.push(deadline(preq->deadline, preq->getId()));
+  this->getServer()->getExecutor()->wake(this, preq->deadline);
+}
+
+// Resumes the request a reply is for. Returns false if the request is not a reply
+bool Lobby::resume(client_t client, json& req)
+{
+  auto id = req.find("request_id");
+  if (id == req.end() || !id->is_string()) return false;
+  preq_id_t requestId;
+  if (!parsedecimal(id->get_ref<const string&>(), requestId)) return true;
+  auto it = this->requests.find(requestId);
+  if (it == this->requests.end() || it->second->getType() != req["cmd"].get_ref<const string&>()) return true;
+  preq_t preq = it->second;
+  if (preq->onReply) preq->onReply(preq, client, req);
+  return true;
+}
+
+// Stops waiting on a request, counting it as answered
+void Lobby::complete(preq_t preq)
+{
+  std::lock_guard<std::recursive_mutex> guard(this->mutex);
+  if (this->requests.erase(preq->getId()) == 0) return;
+  this->getServer()->getPersistentRequestManager()->complete(preq, preq->timedOut);
+}
+
+// Resumes the requests whose deadline has passed, dropping any that are neither completed nor waited on again
+void Lobby::expire()
+{
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  while (!this->deadlines.empty() && this->deadlines.top().first <= now) {
+    deadline d = this->deadlines.top();
+    this->deadlines.pop();
+    auto it = this->requests.find(d.second);
+    if (it == this->requests.end() || it->second->deadline != d.first) continue;
+    preq_t preq = it->second;
+    preq->timedOut = true;
+    if (preq->onTimeout) {
+      try {
+        preq->onTimeout(preq);
+      } catch (std::exception& e) {
+        logger::error << e.what() << std::endl;
+      }
+    }
+    if (!preq->timedOut || !this->requests.count(preq->getId())) continue;
+    this->requests.erase(preq->getId());
+    this->getServer()->getPersistentRequestManager()->expire(preq);
+  }
+}
+
+int Lobby::getWorker()
+{
+  return this->worker;
+}
+
+void Lobby::setWorker(int worker)
+{
+  this->worker = worker;
+}
+
 int Lobby::getRoomNumber()
 {
   return this->roomNumber;
@@ -112,7 +258,7 @@ server_t Lobby::getServer()
 
 lobby_listener_t Lobby::getEventListener()
 {
-  return this->listener;
+  return this->getServer()->getLobbyEventListener();
 }
 
 client_list_t Lobby::getClients()
@@ -120,14 +266,23 @@ client_list_t Lobby::getClients()
   return this->clients;
 }
 
+// Returns the client in this lobby with the given Steam ID, or nullptr if there is none
+client_t Lobby::getClient(steamid_t steamId)
+{
+  auto it = this->members.find(steamId);
+  if (it == this->members.end()) return nullptr;
+  return it->second;
+}
+
 game_t Lobby::getGame()
 {
-  return this->game;
+  return &this->game;
 }
 
+// Builds a stream that prefixes lines with the room number. Lobbies log rarely, so the prefix is not kept around
 logger::stream Lobby::getLogger()
 {
-  return this->logger;
+  return logger::stream(string("[INFO] [ROOM ") + std::to_string(this->roomNumber) + "] ", std::cout);
 }
 
 json Lobby::getJSON()
@@ -136,7 +291,7 @@ json Lobby::getJSON()
   data["players"] = json::array();
   for (client_t c : this->getClients()) {
     json p;
-    p["id"] = c->getPlayer()->getSteamId();
+    p["id"] = std::to_string(c->getPlayer()->getSteamId());
     if (this->getServer()->getConfig()->isSteamApiEnabled()) p["name"] = c->getPlayer()->getName();
     data["players"].push_back(p);
   }
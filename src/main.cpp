@@ -23,8 +23,7 @@ int main() {
   auto stopFunc = [](int s) { delete server; exit(0); };
   signal(SIGTERM, stopFunc);
   signal(SIGINT, stopFunc);
+  signal(SIGPIPE, SIG_IGN);
 
-  while (true) {
-    server->acceptClient();
-  }
+  server->run();
 }
\ No newline at end of file
@@ -0,0 +1,271 @@
+#include <cstdio>
+#include <unordered_set>
+#include "httplib.h"
+#include "util/logs.hpp"
+#include "util/misc.hpp"
+#include "util/response.hpp"
+#include "names.hpp"
+#include "server.hpp"
+#include "lobby.hpp"
+#include "client.hpp"
+#include "player.hpp"
+
+using namespace balatrogether;
+
+NameCache::NameCache(size_t capacity, int ttl) : capacity(capacity), ttl(ttl)
+{
+}
+
+// Looks up an unexpired name, marking it as recently used
+bool NameCache::get(steamid_t steamId, string& name)
+{
+  auto it = this->index.find(steamId);
+  if (it == this->index.end()) return false;
+  if (it->second->expires <= std::chrono::steady_clock::now()) {
+    this->entries.erase(it->second);
+    this->index.erase(it);
+    return false;
+  }
+  this->entries.splice(this->entries.begin(), this->entries, it->second);
+  name = it->second->name;
+  return true;
+}
+
+// Stores a name for the full TTL, evicting the least recently used names past the capacity
+void NameCache::put(steamid_t steamId, const string& name)
+{
+  this->insert(steamId, name, std::chrono::steady_clock::now() + this->ttl);
+}
+
+size_t NameCache::size()
+{
+  return this->entries.size();
+}
+
+// Replaces the contents with a snapshot written by save, skipping expired entries. Returns false if it cannot be read
+bool NameCache::load(const string& path)
+{
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file) return false;
+  std::vector<uint8_t> bytes;
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) bytes.insert(bytes.end(), chunk, chunk + n);
+  fclose(file);
+
+  json snapshot = json::from_msgpack(bytes, true, false);
+  if (!snapshot.is_array()) return false;
+  this->entries.clear();
+  this->index.clear();
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  long long wall = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  for (auto it = snapshot.rbegin(); it != snapshot.rend(); it++) {
+    json& e = *it;
+    if (!e.is_array() || e.size() != 3 || !e[0].is_number_unsigned() || !e[1].is_number_integer() || !e[2].is_string()) continue;
+    long long remaining = e[1].get<long long>() - wall;
+    if (remaining <= 0) continue;
+    std::chrono::seconds left = std::min(std::chrono::seconds(remaining), this->ttl);
+    this->insert(e[0].get<steamid_t>(), e[2].get<string>(), now + left);
+  }
+  return true;
+}
+
+// Writes the unexpired names, most recently used first, as MessagePack and replaces the file in one step
+bool NameCache::save(const string& path)
+{
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  long long wall = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  json snapshot = json::array();
+  for (entry& e : this->entries) {
+    if (e.expires <= now) continue;
+    long long remaining = std::chrono::duration_cast<std::chrono::seconds>(e.expires - now).count();
+    snapshot.push_back(json::array({e.steamId, wall + remaining, e.name}));
+  }
+  std::vector<uint8_t> bytes = json::to_msgpack(snapshot);
+
+  string temp = path + ".tmp";
+  FILE *file = fopen(temp.c_str(), "wb");
+  if (!file) return false;
+  bool written = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+  written = fclose(file) == 0 && written;
+  if (!written || rename(temp.c_str(), path.c_str()) != 0) {
+    remove(temp.c_str());
+    return false;
+  }
+  return true;
+}
+
+void NameCache::insert(steamid_t steamId, const string& name, std::chrono::steady_clock::time_point expires)
+{
+  if (this->capacity == 0) return;
+  auto it = this->index.find(steamId);
+  if (it != this->index.end()) {
+    it->second->name = name;
+    it->second->expires = expires;
+    this->entries.splice(this->entries.begin(), this->entries, it->second);
+    return;
+  }
+  this->entries.push_front(entry{steamId, name, expires});
+  this->index[steamId] = this->entries.begin();
+  while (this->entries.size() > this->capacity) {
+    this->index.erase(this->entries.back().steamId);
+    this->entries.pop_back();
+  }
+}
+
+NameResolver::NameResolver(server_t server, string url, string key, int threads, size_t cacheSize, int cacheTTL) : cache(cacheSize, cacheTTL), failures(0), running(true)
+{
+  this->server = server;
+  this->url = url;
+  this->key = key;
+  if (this->cache.load(getpath() + "/" + NAME_CACHE_FILE)) {
+    logger::info << "Loaded " << this->cache.size() << " cached display name(s)" << std::endl;
+  }
+  for (int i = 0; i < threads; i++) {
+    this->workers.push_back(std::thread(&NameResolver::loop, this));
+  }
+  logger::info << "Name resolver started with " << threads << " worker(s)" << std::endl;
+}
+
+NameResolver::~NameResolver()
+{
+  this->stop();
+}
+
+// Returns the cached display name, or an empty string after queueing the Steam ID to be fetched
+string NameResolver::lookup(steamid_t steamId)
+{
+  std::lock_guard<std::mutex> guard(this->mutex);
+  string name;
+  if (this->cache.get(steamId, name)) return name;
+  if (this->queued.insert(steamId).second) {
+    this->pending.push_back(steamId);
+    this->ready.notify_one();
+  }
+  return "";
+}
+
+// Stops the workers, waiting for any request in flight to finish or time out, then snapshots the cache
+void NameResolver::stop()
+{
+  {
+    std::lock_guard<std::mutex> guard(this->mutex);
+    if (!this->running) return;
+    this->running = false;
+    this->ready.notify_all();
+  }
+  for (std::thread& t : this->workers) {
+    if (t.joinable()) t.join();
+  }
+  this->workers.clear();
+  if (!this->cache.save(getpath() + "/" + NAME_CACHE_FILE)) {
+    logger::error << "Failed to save display name cache" << std::endl;
+  }
+}
+
+// Requests a batch of display names from the Web API. Returns false if the response is unusable
+bool NameResolver::fetch(httplib::Client& http, const std::vector<steamid_t>& ids, name_map_t& names)
+{
+  string list;
+  for (steamid_t id : ids) {
+    if (list.size() > 0) list += ",";
+    list += std::to_string(id);
+  }
+  httplib::Result res = http.Get("/ISteamUser/GetPlayerSummaries/v0002/?key=" + this->key + "&steamids=" + list);
+  if (!res) {
+    logger::debug << "Steam API request failed: " << httplib::to_string(res.error()) << std::endl;
+    return false;
+  }
+  if (res->status < 200 || res->status >= 300) {
+    logger::debug << "Steam API returned status " << res->status << std::endl;
+    return false;
+  }
+  json body = json::parse(res->body, nullptr, false);
+  if (!body.is_object() || !body["response"].is_object() || !body["response"]["players"].is_array()) return false;
+  for (json& p : body["response"]["players"]) {
+    steamid_t id;
+    if (!p.is_object() || !p["steamid"].is_string() || !p["personaname"].is_string()) continue;
+    if (!parsesteamid(p["steamid"].get_ref<const string&>(), id)) continue;
+    names[id] = p["personaname"].get<string>();
+  }
+  return true;
+}
+
+// Stores fetched names on the connected players and sends each affected lobby its player list
+void NameResolver::publish(const name_map_t& names)
+{
+  if (names.empty()) return;
+  this->server->lock();
+  std::unordered_set<lobby_t> lobbies;
+  for (client_t c : this->server->getClients()) {
+    player_t player = c->getPlayer();
+    if (!player) continue;
+    auto it = names.find(player->getSteamId());
+    if (it == names.end()) continue;
+    player->setName(it->second);
+    lobby_t lobby = c->getLobby();
+    if (lobby) lobbies.insert(lobby);
+  }
+  for (lobby_t lobby : lobbies) {
+    lobby->lock();
+    lobby->broadcast(response::success("PLAYERS", lobby->getJSON()));
+    lobby->unlock();
+  }
+  this->server->unlock();
+}
+
+// Fetches queued IDs in batches, holding back while the breaker is open and probing with one batch after it
+void NameResolver::loop()
+{
+  httplib::Client http(this->url);
+  http.set_keep_alive(true);
+  http.set_connection_timeout(NAME_CONNECT_TIMEOUT_S);
+  http.set_read_timeout(NAME_READ_TIMEOUT_S);
+
+  std::unique_lock<std::mutex> lock(this->mutex);
+  while (this->running) {
+    if (this->pending.empty()) {
+      this->ready.wait(lock);
+      continue;
+    }
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now < this->openUntil) {
+      this->ready.wait_until(lock, this->openUntil);
+      continue;
+    }
+    std::vector<steamid_t> ids;
+    while (!this->pending.empty() && ids.size() < NAME_BATCH_SIZE) {
+      ids.push_back(this->pending.front());
+      this->pending.pop_front();
+    }
+    if (this->failures >= NAME_BREAKER_FAILURES) this->openUntil = now + std::chrono::seconds(NAME_BREAKER_COOLDOWN_S);
+    lock.unlock();
+
+    name_map_t names;
+    bool success = this->fetch(http, ids, names);
+
+    lock.lock();
+    if (!success) {
+      this->failures++;
+      if (this->failures >= NAME_BREAKER_FAILURES) {
+        if (this->failures == NAME_BREAKER_FAILURES) logger::error << "Steam API is not responding, pausing name lookups for " << NAME_BREAKER_COOLDOWN_S << " seconds" << std::endl;
+        this->openUntil = std::chrono::steady_clock::now() + std::chrono::seconds(NAME_BREAKER_COOLDOWN_S);
+      }
+      this->pending.insert(this->pending.begin(), ids.begin(), ids.end());
+      continue;
+    }
+    if (this->failures >= NAME_BREAKER_FAILURES) logger::info << "Steam API is responding again, resuming name lookups" << std::endl;
+    this->failures = 0;
+    this->openUntil = std::chrono::steady_clock::time_point();
+    for (steamid_t id : ids) {
+      this->queued.erase(id);
+      auto it = names.find(id);
+      if (it != names.end()) this->cache.put(id, it->second);
+    }
+    this->ready.notify_all();
+    if (!this->running) break;
+    lock.unlock();
+    this->publish(names);
+    lock.lock();
+  }
+}
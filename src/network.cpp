@@ -1,11 +1,23 @@
+#include <errno.h>
+#include <unordered_set>
 #include "network.hpp"
 #include "util/logs.hpp"
+#include "util/request.hpp"
 #include "client.hpp"
+#include "reactor.hpp"
 
 using namespace balatrogether;
 
-NetworkManager::NetworkManager(bool ssl, bool outputKey)
+// Messages that only mirror another player's cursor. They are the first to go when a client falls behind
+static const std::unordered_set<string> cosmetic_commands = {
+  "HIGHLIGHT",
+  "UNHIGHLIGHT",
+  "UNHIGHLIGHT_ALL",
+};
+
+NetworkManager::NetworkManager(bool ssl, bool outputKey, size_t highWater)
 {
+  this->highWater = highWater;
   if (ssl) {
     this->ssl_ctx = ssl::create_context();
     ssl::configure_context(this->ssl_ctx, outputKey);
@@ -20,102 +32,222 @@ NetworkManager::~NetworkManager()
   if (this->ssl_ctx) SSL_CTX_free(this->ssl_ctx);
 }
 
-// Completes the SSL handshake with a client
-bool NetworkManager::handshake(client_t c)
+// Routes outgoing messages through the event loop when its backend writes asynchronously
+void NetworkManager::attach(reactor_t reactor)
 {
-  if (!this->ssl_ctx) return true;
-  SSL *ssl = SSL_new(this->ssl_ctx);
-  if (SSL_set_fd(ssl, c->getFd()) != 1) {
-    return false;
+  this->reactor = reactor;
+}
+
+// Advances the TLS handshake with a client without blocking. Plaintext clients are always complete
+handshake_status_t NetworkManager::handshake(client_t c)
+{
+  if (!this->ssl_ctx) return HANDSHAKE_COMPLETE;
+  std::lock_guard<std::mutex> guard(c->io);
+  SSL *ssl = c->getSSL();
+  if (!ssl) {
+    ssl = SSL_new(this->ssl_ctx);
+    if (!ssl) return HANDSHAKE_FAILED;
+    c->setSSL(ssl);
+    if (SSL_set_fd(ssl, c->getFd()) != 1) return HANDSHAKE_FAILED;
+    SSL_set_accept_state(ssl);
   }
-  c->setSSL(ssl);
-  return SSL_accept(ssl) == 1;
+  if (SSL_is_init_finished(ssl)) return HANDSHAKE_COMPLETE;
+
+  int s = SSL_accept(ssl);
+  if (s == 1) return HANDSHAKE_COMPLETE;
+  int err = SSL_get_error(ssl, s);
+  if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) return HANDSHAKE_PENDING;
+  return HANDSHAKE_FAILED;
 }
 
-// Sends a JSON object to a list of clients
-void NetworkManager::send(client_list_t receivers, json payload)
+// Serializes a JSON object once and queues it on every client in the list
+void NetworkManager::send(const client_list_t& receivers, const json& payload)
 {
-  char buffer[BUFFER_SIZE];
-  memset(buffer, 0, BUFFER_SIZE);
-  string jsonString = payload.dump();
-  strncpy(buffer, jsonString.c_str(), BUFFER_SIZE - 2);
-  buffer[jsonString.size()] = '\n';
+  if (receivers.empty()) return;
+  string wire = payload.dump();
+  wire.push_back('\n');
+  wire_buffer_t buffer = std::make_shared<const string>(std::move(wire));
+  bool cosmetic = this->isCosmetic(payload);
+  string echo;
+  if (logger::debug.isEnabled()) echo = buffer->substr(0, buffer->size() - 1);
   for (client_t receiver : receivers) {
-    size_t n = this->write(receiver, buffer, strlen(buffer));
-    if (n > 0) logger::debug << "Server -> " << receiver->getIdentity() << ": " << payload.dump() << std::endl;
+    bool queued = this->enqueue(receiver, buffer, cosmetic);
+    if (queued && logger::debug.isEnabled()) logger::debug << "Server -> " << receiver->getIdentity() << ": " << echo << std::endl;
   }
+  if (this->reactor) this->reactor->commit();
 }
 
-// Receive JSON from a client. Returns a null json object if parsing fails or the client has disconnected
-json NetworkManager::receive(client_t sender)
+// Writes the client's queued output once its socket is writable again. Returns false if the connection has failed
+bool NetworkManager::flush(client_t c)
 {
-  char buffer[BUFFER_SIZE];
-  memset(buffer, 0, BUFFER_SIZE);
-  size_t n = this->peek(sender, buffer, BUFFER_SIZE);
-  size_t read_amount = 0;
-  for (size_t i = 0; i < n && i < BUFFER_SIZE; i++) {
-    if (buffer[i] == '\n') {
-      read_amount = i + 1;
-      break;
+  std::lock_guard<std::mutex> guard(c->io);
+  return this->drain(c);
+}
+
+// Returns true if a TLS read is waiting for the socket to become writable
+bool NetworkManager::isReadBlocked(client_t c)
+{
+  std::lock_guard<std::mutex> guard(c->io);
+  return c->readBlocked;
+}
+
+// Returns true if the payload may be dropped for a client that has fallen behind
+bool NetworkManager::isCosmetic(const json& payload)
+{
+  auto cmd = payload.find("cmd");
+  return cmd != payload.end() && cmd->is_string() && cosmetic_commands.count(cmd->get_ref<const string&>()) > 0;
+}
+
+// Queues a message for the client under the slow consumer policy. Returns false if the message was not queued
+bool NetworkManager::enqueue(client_t c, const wire_buffer_t& buffer, bool cosmetic)
+{
+  std::lock_guard<std::mutex> guard(c->io);
+  if (c->isClosed()) return false;
+  if (c->outbox.bytes() >= this->highWater) {
+    if (cosmetic) {
+      c->outbox.drop();
+      return false;
+    }
+    c->outbox.purge();
+    if (c->outbox.bytes() >= this->highWater && c->outbox.stalled() >= SEND_STALL_MS) {
+      logger::error << "Disconnecting " << c->getIdentity() << " with " << c->outbox.bytes() << " bytes of unsent output" << std::endl;
+      c->close();
+      return false;
+    }
+    if (c->outbox.bytes() + buffer->size() > this->highWater * SEND_HARD_LIMIT_FACTOR) {
+      logger::error << "Disconnecting " << c->getIdentity() << " for exceeding the send queue limit with " << c->outbox.bytes() << " bytes of unsent output" << std::endl;
+      c->close();
+      return false;
     }
   }
-  if (read_amount == 0) return json();
-
-  memset(buffer, 0, BUFFER_SIZE);
-  n = this->read(sender, buffer, read_amount);
-  if (n == 0) return json();
-
-  try {
-    buffer[n - 1] = '\0';
-    logger::debug << sender->getIdentity() << " -> Server: " << buffer << std::endl;
-    json req = json::parse(buffer);
-    return req;
-  } catch (...) {
-    return json();
-  }
+  c->outbox.push(buffer, cosmetic);
+  if (this->reactor && this->reactor->submit(c)) return true;
+  if (!this->drain(c)) c->close();
+  return true;
 }
 
-size_t NetworkManager::peek(client_t client, char* buffer, size_t bytes)
+// Disconnects the client if it is over the high water mark and stalled. Returns false if it was disconnected
+bool NetworkManager::checkStall(client_t c)
 {
-  size_t n;
-  if (this->ssl_ctx && client->getSSL()) {
-    int s = SSL_peek_ex(client->getSSL(), buffer, bytes, &n);
-    if (s <= 0) {
-      logger::debug << "SSL peek error " << SSL_get_error(client->getSSL(), s) << std::endl;
-      n = 0;
+  std::lock_guard<std::mutex> guard(c->io);
+  if (c->isClosed() || c->outbox.bytes() < this->highWater || c->outbox.stalled() < SEND_STALL_MS) return true;
+  logger::error << "Disconnecting " << c->getIdentity() << " with " << c->outbox.bytes() << " bytes of unsent output" << std::endl;
+  c->close();
+  return false;
+}
+
+// Reads until the socket would block, collecting complete lines. Returns false if the client has to be disconnected
+bool NetworkManager::receive(client_t sender, std::vector<json>& messages)
+{
+  while (true) {
+    size_t space;
+    char *buffer = sender->inbox.reserve(space);
+    if (!buffer) return this->extract(sender, messages);
+    ssize_t n = this->read(sender, buffer, space);
+    if (n < 0) {
+      std::lock_guard<std::mutex> guard(sender->io);
+      return !sender->writeBlocked || this->drain(sender);
     }
-  } else {
-    n = recv(client->getFd(), buffer, bytes, MSG_PEEK);
+    if (n == 0) return false;
+    sender->inbox.commit(n);
+    if (!this->extract(sender, messages)) return false;
   }
-  return n;
 }
 
-size_t NetworkManager::read(client_t client, char* buffer, size_t bytes)
+// Appends bytes received elsewhere to the client's input buffer and extracts every complete line
+bool NetworkManager::frame(client_t sender, const char* data, size_t bytes, std::vector<json>& messages)
+{
+  while (bytes > 0) {
+    size_t space;
+    char *buffer = sender->inbox.reserve(space);
+    if (!buffer) return this->extract(sender, messages);
+    size_t n = std::min(space, bytes);
+    memcpy(buffer, data, n);
+    sender->inbox.commit(n);
+    data += n;
+    bytes -= n;
+    if (!this->extract(sender, messages)) return false;
+  }
+  return true;
+}
+
+// Parses the complete lines in the client's input buffer. Returns false if the partial line is too long
+bool NetworkManager::extract(client_t sender, std::vector<json>& messages)
+{
+  const char *line;
+  size_t length;
+  while (sender->inbox.next(line, length)) {
+    if (logger::debug.isEnabled()) logger::debug << sender->getIdentity() << " -> Server: " << string(line, length) << std::endl;
+    json req;
+    request::parse_status_t status = request::parse(line, length, req);
+    if (status == request::PARSE_TOO_LARGE) logger::error << "Request from " << sender->getIdentity() << " exceeds its size limits" << std::endl;
+    if (status == request::PARSE_OK) messages.push_back(std::move(req));
+    else messages.push_back(json(status == request::PARSE_TOO_LARGE ? json::value_t::discarded : json::value_t::null));
+  }
+  if (sender->inbox.pending() >= MAX_MESSAGE_SIZE) {
+    logger::error << "Message from " << sender->getIdentity() << " exceeds " << MAX_MESSAGE_SIZE << " bytes" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Reads up to the requested number of bytes. Returns -1 if the read would block and 0 if the client has disconnected
+ssize_t NetworkManager::read(client_t client, char* buffer, size_t bytes)
 {
-  size_t n;
+  std::lock_guard<std::mutex> guard(client->io);
   if (this->ssl_ctx && client->getSSL()) {
+    size_t n;
     int s = SSL_read_ex(client->getSSL(), buffer, bytes, &n);
-    if (s <= 0) {
-      logger::debug << "SSL read error " << SSL_get_error(client->getSSL(), s) << std::endl;
-      n = 0;
-    }
-  } else {
-    n = recv(client->getFd(), buffer, bytes, 0);
+    client->readBlocked = false;
+    if (s > 0) return n;
+    int err = SSL_get_error(client->getSSL(), s);
+    client->readBlocked = err == SSL_ERROR_WANT_WRITE;
+    if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) return -1;
+    logger::debug << "SSL read error " << err << std::endl;
+    return 0;
   }
+  ssize_t n = recv(client->getFd(), buffer, bytes, 0);
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return -1;
+  if (n < 0) return 0;
   return n;
 }
 
-size_t NetworkManager::write(client_t client, char* buffer, size_t bytes)
+// Writes queued output until the socket would block. Must be called with the client's I/O lock held
+bool NetworkManager::drain(client_t c)
 {
-  size_t n;
-  if (this->ssl_ctx && client->getSSL()) {
-    int s = SSL_write_ex(client->getSSL(), buffer, bytes, &n);
-    if (s <= 0) {
-      logger::debug << "SSL write error " << SSL_get_error(client->getSSL(), s) << std::endl;
-      n = 0;
+  c->writeBlocked = false;
+  while (!c->outbox.empty()) {
+    if (this->ssl_ctx && c->getSSL()) {
+      struct iovec iov;
+      c->outbox.gather(&iov, 1);
+      size_t n;
+      int s = SSL_write_ex(c->getSSL(), iov.iov_base, iov.iov_len, &n);
+      if (s > 0) {
+        c->outbox.consume(n);
+        continue;
+      }
+      int err = SSL_get_error(c->getSSL(), s);
+      c->writeBlocked = err == SSL_ERROR_WANT_READ;
+      if (err == SSL_ERROR_WANT_WRITE || err == SSL_ERROR_WANT_READ) {
+        c->outbox.retry();
+        return true;
+      }
+      logger::debug << "SSL write error " << err << std::endl;
+      return false;
     }
-  } else {
-    n = ::send(client->getFd(), buffer, bytes, 0);
+    struct iovec iov[WRITE_IOV_MAX];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = c->outbox.gather(iov, WRITE_IOV_MAX);
+    ssize_t n = sendmsg(c->getFd(), &msg, MSG_NOSIGNAL);
+    if (n >= 0) {
+      c->outbox.consume(n);
+      continue;
+    }
+    if (errno == EINTR) continue;
+    if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+    return false;
   }
-  return n;
+  return true;
 }
@@ -6,7 +6,6 @@ using namespace balatrogether;
 Player::Player(player_auth auth)
 {
   this->auth = auth;
-  if (auth.fetchKey.size() > 0) this->name = getplayername(auth);
 }
 
 client_t Player::getClient()
@@ -16,9 +15,17 @@ client_t Player::getClient()
 
 string Player::getName()
 {
+  std::lock_guard<std::mutex> guard(this->mutex);
   return this->name;
 }
 
+// Sets the display name. Names arrive from the name resolver while lobbies may be reading them
+void Player::setName(string name)
+{
+  std::lock_guard<std::mutex> guard(this->mutex);
+  this->name = name;
+}
+
 steamid_t Player::getSteamId()
 {
   return this->auth.steamId;
@@ -1,85 +1,188 @@
-#include <thread>
-#include <chrono>
-#include "util/logs.hpp"
+#include <algorithm>
 #include "preq.hpp"
+#include "game.hpp"
 
 using namespace balatrogether;
 
-typedef std::unordered_map<string, preq_t>::iterator preq_iter_t;
-
-PersistentRequest::PersistentRequest(steamid_t creator)
+PersistentRequest::PersistentRequest(preq_id_t id, string type, steamid_t creator, lobby_t lobby, preq_reply_t onReply, preq_timeout_t onTimeout)
 {
-  this->id = std::to_string(rand());
+  this->id = id;
+  this->type = type;
   this->original = creator;
-  this->data = json();
-  this->created = clock();
+  this->lobby = lobby;
+  this->onReply = onReply;
+  this->onTimeout = onTimeout;
+  this->created = std::chrono::steady_clock::now();
 }
 
-string PersistentRequest::getId()
+preq_id_t PersistentRequest::getId()
 {
   return this->id;
 }
 
+string PersistentRequest::getType()
+{
+  return this->type;
+}
+
 steamid_t PersistentRequest::getCreator()
 {
   return this->original;
 }
 
-json PersistentRequest::getData()
+lobby_t PersistentRequest::getLobby()
+{
+  return this->lobby;
+}
+
+// Returns the slot of the player the request is currently waiting on, or -1 if it is waiting on everyone
+int PersistentRequest::getTarget()
+{
+  return this->target;
+}
+
+void PersistentRequest::setTarget(int slot)
 {
-  return this->data;
+  this->target = slot;
 }
 
-void PersistentRequest::setData(json data)
+// Returns the milliseconds since the request was created
+long PersistentRequest::getAge()
 {
-  this->data = data;
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - this->created).count();
 }
 
-PersistentRequestManager::PersistentRequestManager(int requestLifetime, int collectionInterval)
+bool PersistentRequest::hasContributed(int slot)
 {
-  this->requestLifetime = requestLifetime;
-  this->collectionInterval = collectionInterval;
-  std::thread(&PersistentRequestManager::clearUnresolved, this).detach();
-  logger::info << "Persistent request manager initialized" << std::endl;
+  return slot >= 0 && (size_t) slot < this->contributed.size() && this->contributed[slot];
 }
 
-PersistentRequestManager::~PersistentRequestManager()
+void PersistentRequest::contribute(int slot)
 {
-  for (std::pair<string, preq_t> it : this->requests) {
-    delete it.second;
+  if (slot < 0) return;
+  if ((size_t) slot >= this->contributed.size()) this->contributed.resize(slot + 1, false);
+  this->contributed[slot] = true;
+}
+
+// Returns true once every player still in the run has contributed
+bool PersistentRequest::isComplete(game_t game)
+{
+  for (size_t slot = 0; slot < game->getPlayerCount(); slot++) {
+    if (!game->isSlotEliminated(slot) && !this->hasContributed(slot)) return false;
   }
+  return true;
+}
+
+std::vector<json>& PersistentRequest::getJokers()
+{
+  return this->jokers;
+}
+
+// Offers a card to the sample. Each card seen so far has the same chance of being in it
+void PersistentRequest::addCard(json& card, std::mt19937& random)
+{
+  this->cardsSeen++;
+  if (this->cards.size() < PREQ_CARD_SAMPLE) {
+    this->cards.push_back(std::move(card));
+    return;
+  }
+  uint64_t pick = std::uniform_int_distribution<uint64_t>(0, this->cardsSeen - 1)(random);
+  if (pick < PREQ_CARD_SAMPLE) this->cards[pick] = std::move(card);
+}
+
+// Shuffles the sampled cards into random order and returns them
+std::vector<json>& PersistentRequest::drawCards(std::mt19937& random)
+{
+  std::shuffle(this->cards.begin(), this->cards.end(), random);
+  return this->cards;
 }
 
-preq_t PersistentRequestManager::create(steamid_t creator)
+PersistentRequestManager::PersistentRequestManager() : random(std::random_device()()), created(0), completed(0), partial(0), expired(0)
 {
-  preq_t preq = new PersistentRequest(creator);
-  this->requests.insert(std::make_pair(preq->id, preq));
-  return preq;
 }
 
-preq_t PersistentRequestManager::getById(string requestId)
+// Creates a request with a random ID. It is only pending once the lobby is waiting on it
+preq_t PersistentRequestManager::create(string type, steamid_t creator, lobby_t lobby, preq_reply_t onReply, preq_timeout_t onTimeout)
 {
-  preq_iter_t result = this->requests.find(requestId);
-  if (result == this->requests.end()) return NULL;
-  return result->second;
+  std::lock_guard<std::mutex> guard(this->mutex);
+  preq_id_t id;
+  do {
+    id = this->random();
+  } while (id == 0);
+  this->created++;
+  return preq_t(new PersistentRequest(id, type, creator, lobby, onReply, onTimeout));
 }
 
-void PersistentRequestManager::complete(string requestId)
+// Counts a request that was answered, recording how long it took under its type. Partial requests were answered
+// with what had arrived by their deadline
+void PersistentRequestManager::complete(preq_t preq, bool partial)
 {
-  preq_iter_t result = this->requests.find(requestId);
-  if (result == this->requests.end()) return;
-  this->requests.erase(requestId);
-  delete result->second;
+  std::lock_guard<std::mutex> guard(this->mutex);
+  this->record(preq);
+  this->completed++;
+  if (partial) this->partial++;
+}
+
+// Counts a request that was dropped without an answer
+void PersistentRequestManager::expire(preq_t preq)
+{
+  std::lock_guard<std::mutex> guard(this->mutex);
+  this->record(preq);
+  this->expired++;
+}
+
+uint64_t PersistentRequestManager::getPendingCount()
+{
+  std::lock_guard<std::mutex> guard(this->mutex);
+  return this->created - this->completed - this->expired;
+}
+
+uint64_t PersistentRequestManager::getCreatedCount()
+{
+  std::lock_guard<std::mutex> guard(this->mutex);
+  return this->created;
+}
+
+uint64_t PersistentRequestManager::getCompletedCount()
+{
+  std::lock_guard<std::mutex> guard(this->mutex);
+  return this->completed;
+}
+
+uint64_t PersistentRequestManager::getPartialCount()
+{
+  std::lock_guard<std::mutex> guard(this->mutex);
+  return this->partial;
+}
+
+uint64_t PersistentRequestManager::getExpiredCount()
+{
+  std::lock_guard<std::mutex> guard(this->mutex);
+  return this->expired;
+}
+
+// Returns the most recent latencies of each request type in milliseconds, sorted from fastest to slowest
+std::map<string, std::vector<long>> PersistentRequestManager::getLatencies()
+{
+  std::map<string, std::vector<long>> latencies;
+  {
+    std::lock_guard<std::mutex> guard(this->mutex);
+    for (auto& it : this->latencies) latencies[it.first] = it.second.samples;
+  }
+  for (auto& it : latencies) std::sort(it.second.begin(), it.second.end());
+  return latencies;
 }
 
-void PersistentRequestManager::clearUnresolved()
+// Adds the time since the request was created to its type's samples, replacing the oldest once there are
+// PREQ_LATENCY_SAMPLES of them. Must be called with the lock held
+void PersistentRequestManager::record(preq_t preq)
 {
-  while (true) {
-    std::this_thread::sleep_for(std::chrono::seconds(this->collectionInterval));
-    for (preq_iter_t it = this->requests.begin(); it != this->requests.end(); it++) {
-      if ((clock() - it->second->created) / CLOCKS_PER_SEC > this->requestLifetime) {
-        this->complete(it->second->getId());
-      }
-    }
+  long ms = preq->getAge();
+  latency& l = this->latencies[preq->getType()];
+  if (l.samples.size() < PREQ_LATENCY_SAMPLES) {
+    l.samples.push_back(ms);
+  } else {
+    l.samples[l.next] = ms;
+    l.next = (l.next + 1) % PREQ_LATENCY_SAMPLES;
   }
 }
@@ -0,0 +1,48 @@
+#include "util/logs.hpp"
+#include "reactor.hpp"
+#include "server.hpp"
+#include "lobby.hpp"
+#include "client.hpp"
+#include "executor.hpp"
+
+using namespace balatrogether;
+
+Reactor::Reactor(server_t server)
+{
+  this->server = server;
+}
+
+// Runs the event handler for each message in order. Events for a client in a lobby are queued on the lobby and
+// run by the executor; the rest run here with the server locked. Returns false once the client should be
+// disconnected
+bool Reactor::dispatch(client_t c, std::vector<json>& messages)
+{
+  for (json& req : messages) {
+    if (req.is_null() || (!req.is_discarded() && !req["cmd"].is_string())) return false;
+
+    lobby_t lobby = c->getLobby();
+    if (lobby) {
+      this->server->getExecutor()->submit(lobby, c, std::move(req));
+      continue;
+    }
+
+    this->server->lock();
+    bool success = false;
+    if (!c->isClosed()) success = this->server->getEventListener()->process(c, req);
+    this->server->unlock();
+
+    if (!success || c->isClosed()) return false;
+  }
+  return true;
+}
+
+// Disconnects the client and drops the loop's reference to it. Only the loop that owns the client may release it
+void Reactor::release(client_t c)
+{
+  this->server->lock();
+  string ip = c->getIP();
+  this->server->disconnect(c);
+  c->unref();
+  logger::info << "Client from " << ip << " disconnected" << std::endl;
+  this->server->unlock();
+}
@@ -0,0 +1,139 @@
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <errno.h>
+#include <unistd.h>
+#include "util/logs.hpp"
+#include "reactors/epoll.hpp"
+#include "server.hpp"
+#include "client.hpp"
+
+using namespace balatrogether;
+
+// Creates one edge-triggered epoll instance per I/O thread. The listening socket is watched by the first loop only
+EpollReactor::EpollReactor(server_t server, int listenfd, int threads) : Reactor(server), next(0), running(true)
+{
+  this->listenfd = listenfd;
+  this->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (threads < 1) threads = 1;
+
+  for (int i = 0; i < threads; i++) {
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+      logger::error << "Failed to create event loop" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = &this->wakefd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, this->wakefd, &ev);
+    this->epfds.push_back(epfd);
+  }
+
+  struct epoll_event ev;
+  ev.events = EPOLLIN | EPOLLET;
+  ev.data.ptr = nullptr;
+  if (epoll_ctl(this->epfds.at(0), EPOLL_CTL_ADD, this->listenfd, &ev) < 0) {
+    logger::error << "Failed to watch listening socket" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  logger::info << "Event loop initialized with " << threads << " I/O thread(s)" << std::endl;
+}
+
+// Wakes every loop and closes the epoll instances. Threads are detached rather than joined since they may be
+// waiting on the server lock held by whoever is shutting the server down
+EpollReactor::~EpollReactor()
+{
+  this->stop();
+  for (std::thread& t : this->threads) {
+    if (t.joinable()) t.detach();
+  }
+  for (int epfd : this->epfds) close(epfd);
+  close(this->wakefd);
+}
+
+// Starts the secondary I/O threads and runs the first loop on the calling thread
+void EpollReactor::run()
+{
+  for (size_t i = 1; i < this->epfds.size(); i++) {
+    this->threads.push_back(std::thread(&EpollReactor::loop, this, i));
+  }
+  this->loop(0);
+}
+
+// Signals every loop to return after its current batch of events
+void EpollReactor::stop()
+{
+  this->running = false;
+  uint64_t one = 1;
+  if (::write(this->wakefd, &one, sizeof(one)) < 0) return;
+}
+
+// Registers an accepted client with the next loop in round-robin order
+void EpollReactor::add(client_t c)
+{
+  int epfd = this->epfds.at(this->next++ % this->epfds.size());
+  struct epoll_event ev;
+  ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+  ev.data.ptr = c;
+  if (epoll_ctl(epfd, EPOLL_CTL_ADD, c->getFd(), &ev) < 0) {
+    logger::error << "Failed to watch client from " << c->getIP() << std::endl;
+    c->unref();
+  }
+}
+
+void EpollReactor::loop(int index)
+{
+  int epfd = this->epfds.at(index);
+  struct epoll_event events[EPOLL_MAX_EVENTS];
+  while (this->running) {
+    int n = epoll_wait(epfd, events, EPOLL_MAX_EVENTS, -1);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    for (int i = 0; i < n && this->running; i++) {
+      void *ptr = events[i].data.ptr;
+      if (ptr == nullptr) {
+        this->server->acceptClient();
+      } else if (ptr != &this->wakefd) {
+        this->handle(epfd, (client_t) ptr, events[i].events);
+      }
+    }
+  }
+}
+
+// Completes the TLS handshake if needed, resumes writing queued output once the socket is writable, then
+// dispatches every complete message the client has sent
+void EpollReactor::handle(int epfd, client_t c, uint32_t events)
+{
+  network_t net = this->server->getNetworkManager();
+  handshake_status_t status = net->handshake(c);
+  if (status == HANDSHAKE_PENDING) return;
+  if (status == HANDSHAKE_FAILED) {
+    logger::error << "TLS handshake failed for " << c->getIP() << std::endl;
+    this->forget(epfd, c);
+    return;
+  }
+
+  bool readable = events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR);
+  if (events & EPOLLOUT) {
+    if (!net->flush(c)) {
+      this->forget(epfd, c);
+      return;
+    }
+    readable = readable || net->isReadBlocked(c);
+  }
+  if (!readable) return;
+
+  std::vector<json> messages;
+  bool open = net->receive(c, messages);
+  if (!this->dispatch(c, messages) || !open) this->forget(epfd, c);
+}
+
+// Stops watching the client and releases it. Queued lobby requests may keep the client alive for a while, so its
+// socket must not produce more events here
+void EpollReactor::forget(int epfd, client_t c)
+{
+  epoll_ctl(epfd, EPOLL_CTL_DEL, c->getFd(), nullptr);
+  this->release(c);
+}
@@ -0,0 +1,421 @@
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include "util/logs.hpp"
+#include "reactors/uring.hpp"
+#include "server.hpp"
+#include "client.hpp"
+
+#define URING_TAG_MASK 7
+#define URING_TAG_ACCEPT 1
+#define URING_TAG_RECV 2
+#define URING_TAG_SEND 3
+#define URING_TAG_WAKE 4
+
+using namespace balatrogether;
+
+static int uring_setup(unsigned entries, struct io_uring_params *p)
+{
+  return (int) syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+  return (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+  return (int) syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+// Maps the submission and completion rings and registers the provided receive buffers
+UringReactor::UringReactor(server_t server, int listenfd) : Reactor(server), running(true)
+{
+  this->listenfd = listenfd;
+
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  this->ringfd = uring_setup(URING_ENTRIES, &params);
+  if (this->ringfd < 0) {
+    logger::error << "Failed to create io_uring instance" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  this->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  this->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    this->sqRingSize = this->cqRingSize = std::max(this->sqRingSize, this->cqRingSize);
+  }
+  this->sqRing = mmap(NULL, this->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ringfd, IORING_OFF_SQ_RING);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    this->cqRing = this->sqRing;
+  } else {
+    this->cqRing = mmap(NULL, this->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ringfd, IORING_OFF_CQ_RING);
+  }
+  this->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+  this->sqes = (struct io_uring_sqe*) mmap(NULL, this->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ringfd, IORING_OFF_SQES);
+  if (this->sqRing == MAP_FAILED || this->cqRing == MAP_FAILED || this->sqes == MAP_FAILED) {
+    logger::error << "Failed to map io_uring rings" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  char *sq = (char*) this->sqRing;
+  this->sqHead = (unsigned*) (sq + params.sq_off.head);
+  this->sqTail = (unsigned*) (sq + params.sq_off.tail);
+  this->sqMask = (unsigned*) (sq + params.sq_off.ring_mask);
+  this->sqArray = (unsigned*) (sq + params.sq_off.array);
+  this->sqEntries = params.sq_entries;
+  this->sqLocalTail = *this->sqTail;
+  char *cq = (char*) this->cqRing;
+  this->cqHead = (unsigned*) (cq + params.cq_off.head);
+  this->cqTail = (unsigned*) (cq + params.cq_off.tail);
+  this->cqMask = (unsigned*) (cq + params.cq_off.ring_mask);
+  this->cqes = (struct io_uring_cqe*) (cq + params.cq_off.cqes);
+
+  size_t bufRingSize = URING_BUFFER_COUNT * sizeof(struct io_uring_buf);
+  this->bufRing = (struct io_uring_buf_ring*) mmap(NULL, bufRingSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  this->buffers = new char[URING_BUFFER_COUNT * URING_BUFFER_SIZE];
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = (uint64_t) this->bufRing;
+  reg.ring_entries = URING_BUFFER_COUNT;
+  reg.bgid = URING_BUFFER_GROUP;
+  if (this->bufRing == MAP_FAILED || uring_register(this->ringfd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+    logger::error << "Failed to register io_uring receive buffers" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  for (uint16_t bid = 0; bid < URING_BUFFER_COUNT; bid++) {
+    this->recycle(bid);
+  }
+
+  logger::info << "Event loop initialized with io_uring" << std::endl;
+}
+
+UringReactor::~UringReactor()
+{
+  this->stop();
+  munmap(this->sqes, this->sqesSize);
+  if (this->cqRing != this->sqRing) munmap(this->cqRing, this->cqRingSize);
+  munmap(this->sqRing, this->sqRingSize);
+  munmap(this->bufRing, URING_BUFFER_COUNT * sizeof(struct io_uring_buf));
+  close(this->ringfd);
+  delete[] this->buffers;
+}
+
+// Returns true if the kernel supports the opcodes the reactor submits
+static bool probe_opcodes(int ringfd)
+{
+  std::vector<char> mem(sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op), 0);
+  struct io_uring_probe *probe = (struct io_uring_probe*) mem.data();
+  if (uring_register(ringfd, IORING_REGISTER_PROBE, probe, 256) < 0) return false;
+  struct io_uring_probe_op *ops = (struct io_uring_probe_op*) (mem.data() + sizeof(struct io_uring_probe));
+  const int needed[] = {IORING_OP_NOP, IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SENDMSG};
+  for (int op : needed) {
+    if (op > probe->last_op || !(ops[op].flags & IO_URING_OP_SUPPORTED)) return false;
+  }
+  return true;
+}
+
+// Registers a one-entry provided buffer ring and starts a multishot receive into it on one end of a socket pair.
+// Kernels without buffer rings refuse the registration, and kernels without multishot receives reject the
+// request, so neither can be told apart from a working kernel by opcode alone
+static bool probe_multishot(int ringfd, struct io_uring_params& params)
+{
+  if (!(params.features & IORING_FEAT_SINGLE_MMAP)) return false;
+  size_t ringSize = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned), params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe));
+  size_t sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+  char *ring = (char*) mmap(NULL, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringfd, IORING_OFF_SQ_RING);
+  struct io_uring_sqe *sqes = (struct io_uring_sqe*) mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringfd, IORING_OFF_SQES);
+  struct io_uring_buf *bufRing = (struct io_uring_buf*) mmap(NULL, sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  int pair[2] = {-1, -1};
+  char buffer[16];
+  bool supported = false;
+
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = (uint64_t) bufRing;
+  reg.ring_entries = 1;
+  reg.bgid = URING_BUFFER_GROUP;
+  if (ring != MAP_FAILED && sqes != MAP_FAILED && bufRing != MAP_FAILED && uring_register(ringfd, IORING_REGISTER_PBUF_RING, &reg, 1) == 0 && socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0) {
+    bufRing->addr = (uint64_t) buffer;
+    bufRing->len = sizeof(buffer);
+    bufRing->bid = 0;
+    __atomic_store_n(&((struct io_uring_buf_ring*) bufRing)->tail, 1, __ATOMIC_RELEASE);
+
+    unsigned *sqTail = (unsigned*) (ring + params.sq_off.tail);
+    unsigned index = *sqTail & *(unsigned*) (ring + params.sq_off.ring_mask);
+    struct io_uring_sqe *sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = pair[0];
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    ((unsigned*) (ring + params.sq_off.array))[index] = index;
+    __atomic_store_n(sqTail, *sqTail + 1, __ATOMIC_RELEASE);
+
+    if (::write(pair[1], "x", 1) == 1 && uring_enter(ringfd, 1, 1, IORING_ENTER_GETEVENTS) >= 0) {
+      unsigned head = *(unsigned*) (ring + params.cq_off.head);
+      if (head != __atomic_load_n((unsigned*) (ring + params.cq_off.tail), __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe *cqes = (struct io_uring_cqe*) (ring + params.cq_off.cqes);
+        struct io_uring_cqe *cqe = &cqes[head & *(unsigned*) (ring + params.cq_off.ring_mask)];
+        supported = cqe->res == 1 && (cqe->flags & IORING_CQE_F_MORE);
+      }
+    }
+  }
+
+  if (pair[0] >= 0) close(pair[0]);
+  if (pair[1] >= 0) close(pair[1]);
+  if (bufRing != MAP_FAILED) munmap(bufRing, sizeof(struct io_uring_buf));
+  if (sqes != MAP_FAILED) munmap(sqes, sqesSize);
+  if (ring != MAP_FAILED) munmap(ring, ringSize);
+  return supported;
+}
+
+// Returns true if the kernel has everything the reactor relies on: the opcodes it submits, provided buffer rings
+// (Linux 5.19) and multishot receives (Linux 6.0). Creating an instance is not enough, since older kernels allow
+// that but fail once the reactor registers its buffers or starts receiving
+bool UringReactor::isSupported()
+{
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  int fd = uring_setup(4, &params);
+  if (fd < 0) return false;
+  bool supported = probe_opcodes(fd) && probe_multishot(fd, params);
+  close(fd);
+  return supported;
+}
+
+// Runs the completion loop on the calling thread. Submissions made while handling a completion are flushed
+// before the next one, and completions that arrive meanwhile are handled in the same pass, so sends are not held
+// back behind a long run of received messages
+void UringReactor::run()
+{
+  this->mutex.lock();
+  this->accept();
+  this->mutex.unlock();
+
+  while (this->running) {
+    this->flush(true);
+    unsigned head = *this->cqHead;
+    for (; head != __atomic_load_n(this->cqTail, __ATOMIC_ACQUIRE); head++) {
+      struct io_uring_cqe cqe = this->cqes[head & *this->cqMask];
+      __atomic_store_n(this->cqHead, head + 1, __ATOMIC_RELEASE);
+      void *ptr = (void*) (cqe.user_data & ~(uint64_t) URING_TAG_MASK);
+      switch (cqe.user_data & URING_TAG_MASK) {
+        case URING_TAG_ACCEPT:
+          this->onAccept(&cqe);
+          break;
+        case URING_TAG_RECV:
+          this->onReceive((client_t) ptr, &cqe);
+          break;
+        case URING_TAG_SEND:
+          this->onSend((client_t) ptr, &cqe);
+          break;
+      }
+      std::lock_guard<std::mutex> guard(this->mutex);
+      if (this->toSubmit > 0) this->flush(false);
+    }
+  }
+}
+
+// Wakes the completion loop with a no-op so that it returns
+void UringReactor::stop()
+{
+  this->running = false;
+  std::lock_guard<std::mutex> guard(this->mutex);
+  struct io_uring_sqe *sqe = this->sqe(URING_TAG_WAKE, nullptr);
+  sqe->opcode = IORING_OP_NOP;
+  this->flush(false);
+}
+
+// Starts a multishot receive for an accepted client
+void UringReactor::add(client_t c)
+{
+  std::lock_guard<std::mutex> guard(this->mutex);
+  this->connections[c];
+  this->receive(c);
+}
+
+// Starts writing the client's queued output. Messages queued while a send is in flight are written by the next
+// one once it completes, which keeps them in order without more than one send per socket. Nothing reaches the
+// kernel until commit is called or the loop flushes. Must be called with the client's I/O lock held
+bool UringReactor::submit(client_t c)
+{
+  std::lock_guard<std::mutex> guard(this->mutex);
+  auto it = this->connections.find(c);
+  if (it == this->connections.end()) return false;
+  if (!it->second.sending) this->sendAll(c, it->second);
+  return true;
+}
+
+// Publishes queued sends, so that a broadcast enters the kernel once rather than once per receiver. This also runs
+// on the completion loop, because an event there may reply to a client and then close it: the send has to be
+// issued before the socket is shut down, or the reply is lost
+void UringReactor::commit()
+{
+  std::lock_guard<std::mutex> guard(this->mutex);
+  this->flush(false);
+}
+
+// Returns the next free submission entry. Must be called with the mutex held
+struct io_uring_sqe *UringReactor::sqe(uint64_t tag, void *ptr)
+{
+  while (this->sqLocalTail - __atomic_load_n(this->sqHead, __ATOMIC_ACQUIRE) >= this->sqEntries) {
+    this->flush(false);
+  }
+  unsigned index = this->sqLocalTail & *this->sqMask;
+  struct io_uring_sqe *sqe = &this->sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->user_data = (uint64_t) ptr | tag;
+  this->sqArray[index] = index;
+  this->sqLocalTail++;
+  this->toSubmit++;
+  return sqe;
+}
+
+// Publishes queued submissions to the kernel. When wait is set, also blocks for at least one completion
+void UringReactor::flush(bool wait)
+{
+  if (wait) this->mutex.lock();
+  unsigned count = this->toSubmit;
+  this->toSubmit = 0;
+  __atomic_store_n(this->sqTail, this->sqLocalTail, __ATOMIC_RELEASE);
+  if (wait) this->mutex.unlock();
+  if (count == 0 && !wait) return;
+  while (uring_enter(this->ringfd, count, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0) < 0 && errno == EINTR) {
+    count = 0;
+  }
+}
+
+void UringReactor::accept()
+{
+  struct io_uring_sqe *sqe = this->sqe(URING_TAG_ACCEPT, nullptr);
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = this->listenfd;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+}
+
+void UringReactor::receive(client_t c)
+{
+  struct io_uring_sqe *sqe = this->sqe(URING_TAG_RECV, c);
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = c->getFd();
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = URING_BUFFER_GROUP;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+}
+
+// Submits the client's queued messages as one gathered send. The messages are claimed in the client's queue so
+// they stay alive until the completion arrives, and the vector lives in the connection for the same reason. Must be
+// called with the client's I/O lock and the mutex held
+void UringReactor::sendAll(client_t c, connection& conn)
+{
+  if (conn.iov.empty()) conn.iov.resize(URING_SEND_BATCH);
+  int count = c->outbox.claim(conn.iov.data(), URING_SEND_BATCH);
+  if (count == 0) return;
+  memset(&conn.msg, 0, sizeof(conn.msg));
+  conn.msg.msg_iov = conn.iov.data();
+  conn.msg.msg_iovlen = count;
+  struct io_uring_sqe *sqe = this->sqe(URING_TAG_SEND, c);
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = c->getFd();
+  sqe->addr = (uint64_t) &conn.msg;
+  sqe->len = 1;
+  sqe->msg_flags = MSG_NOSIGNAL;
+  conn.sending = true;
+}
+
+// Hands a receive buffer back to the kernel. Only called from the loop thread. The entries are indexed by hand
+// because the kernel header's flexible array member is laid out differently when compiled as C++
+void UringReactor::recycle(uint16_t bid)
+{
+  struct io_uring_buf *buf = (struct io_uring_buf*) this->bufRing + (this->bufTail & (URING_BUFFER_COUNT - 1));
+  buf->addr = (uint64_t) (this->buffers + (size_t) bid * URING_BUFFER_SIZE);
+  buf->len = URING_BUFFER_SIZE;
+  buf->bid = bid;
+  this->bufTail++;
+  __atomic_store_n(&this->bufRing->tail, this->bufTail, __ATOMIC_RELEASE);
+}
+
+void UringReactor::onAccept(struct io_uring_cqe *cqe)
+{
+  if (!(cqe->flags & IORING_CQE_F_MORE)) {
+    std::lock_guard<std::mutex> guard(this->mutex);
+    this->accept();
+  }
+  if (cqe->res < 0) return;
+
+  struct sockaddr_in cli_addr;
+  socklen_t cli_len = sizeof(cli_addr);
+  getpeername(cqe->res, (struct sockaddr*) &cli_addr, &cli_len);
+  client_t client = new Client(cqe->res, cli_addr);
+  logger::info << "Client from " << client->getIP() << " attempting to connect" << std::endl;
+  this->add(client);
+}
+
+// Frames and dispatches received bytes. The client is released once its receive has ended and no sends remain
+void UringReactor::onReceive(client_t c, struct io_uring_cqe *cqe)
+{
+  bool more = cqe->flags & IORING_CQE_F_MORE;
+  if (cqe->res > 0 && (cqe->flags & IORING_CQE_F_BUFFER)) {
+    uint16_t bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+    if (!c->isClosed()) {
+      std::vector<json> messages;
+      bool open = this->server->getNetworkManager()->frame(c, this->buffers + (size_t) bid * URING_BUFFER_SIZE, cqe->res, messages);
+      if (!this->dispatch(c, messages) || !open) c->close();
+    }
+    this->recycle(bid);
+  }
+
+  bool rearm = !more && (cqe->res > 0 || cqe->res == -ENOBUFS) && !c->isClosed();
+  if (rearm) {
+    std::lock_guard<std::mutex> guard(this->mutex);
+    this->receive(c);
+    return;
+  }
+  if (more) return;
+
+  bool done = false;
+  this->mutex.lock();
+  connection& conn = this->connections[c];
+  conn.receiving = false;
+  if (!conn.sending) {
+    this->connections.erase(c);
+    done = true;
+  }
+  this->mutex.unlock();
+  if (done) {
+    this->release(c);
+  } else {
+    c->close();
+  }
+}
+
+// Consumes the written bytes from the client's queue. Whatever is left, including the rest of a short send, is
+// written by the next send
+void UringReactor::onSend(client_t c, struct io_uring_cqe *cqe)
+{
+  bool done = false;
+  bool failed = cqe->res < 0 && cqe->res != -EINTR && cqe->res != -EAGAIN;
+  c->io.lock();
+  this->mutex.lock();
+  connection& conn = this->connections[c];
+  if (cqe->res > 0) c->outbox.consume(cqe->res);
+  c->outbox.settle();
+  conn.sending = false;
+  if (!failed && !c->isClosed()) this->sendAll(c, conn);
+  if (!conn.sending && !conn.receiving) {
+    this->connections.erase(c);
+    done = true;
+  }
+  this->mutex.unlock();
+  c->io.unlock();
+  if (failed) c->close();
+  if (done) this->release(c);
+}
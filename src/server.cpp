@@ -3,12 +3,18 @@
 #include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
 #include <thread>
 #include "util/logs.hpp"
 #include "util/misc.hpp"
 #include "server.hpp"
 #include "lobby.hpp"
 #include "client.hpp"
+#include "executor.hpp"
+#include "names.hpp"
+#include "reactors/epoll.hpp"
+#include "reactors/uring.hpp"
 
 using namespace balatrogether;
 
@@ -17,7 +23,7 @@ Server::Server(int port)
 {
   logger::info << "Starting server" << std::endl;
 
-  this->sockfd = socket(AF_INET, SOCK_STREAM, 0);
+  this->sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
   struct sockaddr_in serv_addr;
   serv_addr.sin_family = AF_INET;
   serv_addr.sin_port = htons(port);
@@ -47,26 +53,49 @@ Server::Server(int port)
   }
   logger::info << "Bound to address" << std::endl;
 
-  srand(time(NULL));
   this->config = new Config;
-  this->net = new NetworkManager(this->getConfig()->isTLSEnabled(), this->getConfig()->isDebugMode());
+  this->net = new NetworkManager(this->getConfig()->isTLSEnabled(), this->getConfig()->isDebugMode(), this->getConfig()->getSendHighWater());
   this->listener = new ServerEventListener(this);
+  this->lobbyListener = new LobbyEventListener;
   this->console = new ConsoleEventListener(this);
   this->persistentRequests = new PersistentRequestManager;
   this->lobbies = lobby_list_t(this->getConfig()->getMaxLobbies());
   logger::debug.setEnabled(this->getConfig()->isDebugMode());
 
+  this->executor = new LobbyExecutor(this->getConfig()->getLobbyWorkers(), this->getConfig()->getLobbyStealThreshold());
+
+  this->names = nullptr;
+  if (this->getConfig()->isSteamApiEnabled()) {
+    this->names = new NameResolver(this, this->getConfig()->getSteamApiUrl(), this->getConfig()->getSteamApiKey(), this->getConfig()->getSteamApiWorkers(), this->getConfig()->getNameCacheSize(), this->getConfig()->getNameCacheTTL());
+  }
+
   logger::info << "Creating lobbies" << std::endl;
   for (int i = 0; i < this->getConfig()->getMaxLobbies(); i++) {
     lobbies.at(i) = new Lobby(this, i + 1);
+    this->executor->assign(lobbies.at(i));
   }
   logger::info << "Lobby state setup complete" << std::endl;
   
-  if (listen(this->sockfd, 3) < 0) {
+  if (listen(this->sockfd, SOMAXCONN) < 0) {
     logger::error << "Failed to listen" << std::endl;
     exit(EXIT_FAILURE);
   }
 
+  this->reactor = nullptr;
+  if (this->getConfig()->getIOBackend() == "io_uring") {
+    if (this->getConfig()->isTLSEnabled()) {
+      logger::error << "The io_uring backend does not support TLS, falling back to epoll" << std::endl;
+    } else if (!UringReactor::isSupported()) {
+      logger::error << "io_uring is not available on this system, falling back to epoll" << std::endl;
+    } else {
+      this->reactor = new UringReactor(this, this->sockfd);
+    }
+  }
+  if (!this->reactor) this->reactor = new EpollReactor(this, this->sockfd, this->getConfig()->getIOThreads());
+  this->net->attach(this->reactor);
+
+  this->watching = true;
+  this->watchdog = std::thread(&Server::watch, this);
   std::thread(console_thread, this).detach();
 }
 
@@ -74,7 +103,16 @@ Server::Server(int port)
 Server::~Server()
 {
   logger::info << "Shutting down server" << std::endl;
-  for (client_t c : this->clients) {
+  {
+    std::lock_guard<std::mutex> guard(this->watchMutex);
+    this->watching = false;
+    this->watchWake.notify_all();
+  }
+  if (this->watchdog.joinable()) this->watchdog.join();
+  delete this->names;
+  delete this->reactor;
+  delete this->executor;
+  for (client_t c : this->getClients()) {
     this->disconnect(c);
   }
   for (lobby_t lobby : this->lobbies) {
@@ -83,20 +121,50 @@ Server::~Server()
   delete this->config;
   delete this->net;
   delete this->listener;
+  delete this->lobbyListener;
   delete this->console;
   delete this->persistentRequests;
   close(this->sockfd);
 }
 
-// Accepts an incoming TCP connection and spawns the client's processing thread
+// Checks every connected client for stalled output once per SEND_STALL_CHECK_MS, since the check made when a
+// message is queued never runs for a client that is no longer being sent anything
+void Server::watch()
+{
+  std::unique_lock<std::mutex> lock(this->watchMutex);
+  while (this->watching) {
+    this->watchWake.wait_for(lock, std::chrono::milliseconds(SEND_STALL_CHECK_MS));
+    if (!this->watching) break;
+    lock.unlock();
+    this->lock();
+    for (client_t c : this->clients) this->net->checkStall(c);
+    this->unlock();
+    lock.lock();
+  }
+}
+
+// Runs the network event loop on the calling thread until the server is shut down
+void Server::run()
+{
+  this->reactor->run();
+}
+
+// Accepts every pending TCP connection and hands each one to the event loop
 void Server::acceptClient()
 {
-  struct sockaddr_in cli_addr;
-  socklen_t cli_len = sizeof(cli_addr);
-  int clientfd = accept(this->sockfd, (struct sockaddr*) &cli_addr, &cli_len);
-  client_t client = new Client(clientfd, cli_addr);
-  logger::info << "Client from " << client->getIP() << " attempting to connect" << std::endl;
-  std::thread(client_thread, this, client).detach();
+  while (true) {
+    struct sockaddr_in cli_addr;
+    socklen_t cli_len = sizeof(cli_addr);
+    int clientfd = accept4(this->sockfd, (struct sockaddr*) &cli_addr, &cli_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (clientfd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK) logger::error << "Failed to accept connection" << std::endl;
+      return;
+    }
+    client_t client = new Client(clientfd, cli_addr);
+    logger::info << "Client from " << client->getIP() << " attempting to connect" << std::endl;
+    this->reactor->add(client);
+  }
 }
 
 // Returns false if the server is in progress, is full, or the player has been banned
@@ -104,9 +172,7 @@ bool Server::canConnect(client_t c)
 {
   if (!this->getConfig()->isWhitelisted(c->getPlayer()->getSteamId())) return false;
   if (this->getConfig()->isBanned(c->getPlayer()->getSteamId())) return false;
-  for (client_t client : this->clients) {
-    if (client->getIdentity() == c->getIdentity()) return false;
-  }
+  if (this->registry.count(c->getPlayer()->getSteamId())) return false;
   return true;
 }
 
@@ -115,23 +181,31 @@ void Server::connect(client_t c, player_auth auth)
 {
   if (!c->getPlayer()) c->setPlayer(std::make_shared<Player>(auth));
   if (!this->canConnect(c)) throw client_exception("Cannot connect to server", true);
+  if (this->names) c->getPlayer()->setName(this->names->lookup(c->getPlayer()->getSteamId()));
 
   logger::info << "Client from " << c->getIP() << " joined server with Steam ID " << c->getPlayer()->getSteamId() << std::endl;
+  this->registry[c->getPlayer()->getSteamId()] = this->clients.size();
   this->clients.push_back(c);
 }
 
-// Disconnects a player from the server
+// Disconnects a player from the server. The client is freed by its event loop once the socket has shut down. The
+// last client takes the departing client's place in the list so that the registry only needs one position updated
 void Server::disconnect(client_t c) {
-  for (int i = 0; i < this->clients.size(); i++) {
-    if (this->clients[i] == c) {
-      this->clients.erase(this->clients.begin() + i);
-      lobby_t lobby = c->getLobby();
-      if (lobby) lobby->remove(c);
-      c->setPlayer(nullptr);
-      delete c;
-      break;
+  player_t player = c->getPlayer();
+  auto it = player ? this->registry.find(player->getSteamId()) : this->registry.end();
+  if (it != this->registry.end() && this->clients[it->second] == c) {
+    size_t index = it->second;
+    this->registry.erase(it);
+    if (index != this->clients.size() - 1) {
+      this->clients[index] = this->clients.back();
+      this->registry[this->clients[index]->getPlayer()->getSteamId()] = index;
     }
+    this->clients.pop_back();
+    lobby_t lobby = c->getLobby();
+    if (lobby) lobby->remove(c);
+    c->setPlayer(nullptr);
   }
+  c->close();
 }
 
 lobby_t Server::getDefaultLobby()
@@ -151,7 +225,7 @@ lobby_list_t Server::getLobbies()
   return this->lobbies;
 }
 
-// Locks the mutex
+// Locks the client list and lobby membership. Taken before any lobby lock
 void Server::lock()
 {
   this->mutex.lock();
@@ -168,12 +242,32 @@ client_list_t Server::getClients()
   return this->clients;
 }
 
+// Returns the connected client with the given Steam ID, or nullptr if there is none
+client_t Server::getClient(steamid_t steamId)
+{
+  auto it = this->registry.find(steamId);
+  if (it == this->registry.end()) return nullptr;
+  return this->clients[it->second];
+}
+
 // Returns the internal network manager for the server
 network_t Server::getNetworkManager()
 {
   return this->net;
 }
 
+// Returns the pool that runs lobby events
+executor_t Server::getExecutor()
+{
+  return this->executor;
+}
+
+// Returns the Steam display name lookup service, or nullptr if no Steam API key is set
+name_resolver_t Server::getNameResolver()
+{
+  return this->names;
+}
+
 // Returns the server config
 config_t Server::getConfig()
 {
@@ -186,6 +280,12 @@ server_listener_t Server::getEventListener()
   return this->listener;
 }
 
+// Returns the event listener shared by every lobby
+lobby_listener_t Server::getLobbyEventListener()
+{
+  return this->lobbyListener;
+}
+
 console_listener_t balatrogether::Server::getConsole()
 {
   return this->console;
@@ -205,40 +305,6 @@ void Server::setSocketOption(int level, int option, int value, const char *err_m
   }
 }
 
-// Processes incoming client packets, executing the correct event handler
-void balatrogether::client_thread(server_t server, client_t client) {
-  if (!server->getNetworkManager()->handshake(client)) {
-    server->lock();
-    logger::error << "TLS handshake failed for " << client->getIP() << std::endl;
-    server->disconnect(client);
-    server->unlock();
-    return;
-  }
-
-  while (true) {
-    json req = server->getNetworkManager()->receive(client);
-    if (req == json() || !req["cmd"].is_string()) break;
-
-    server->lock();
-    bool success = false;
-    lobby_t lobby = client->getLobby();
-    if (lobby) { 
-      success = lobby->getEventListener()->process(client, req);
-    } else {
-      success = server->getEventListener()->process(client, req);
-    }
-    server->unlock();
-
-    if (!success) break;
-  }
-
-  server->lock();
-  string ip = client->getIP();
-  server->disconnect(client);
-  logger::info << "Client from " << ip << " disconnected" << std::endl;
-  server->unlock();
-}
-
 void balatrogether::console_thread(server_t server)
 {
   while (true) {
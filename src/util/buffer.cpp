@@ -0,0 +1,185 @@
+#include <string.h>
+#include "util/buffer.hpp"
+
+using namespace balatrogether;
+
+ReadBuffer::ReadBuffer(size_t limit)
+{
+  this->limit = limit;
+}
+
+// Returns free space at the end of the buffer, or nullptr once the partial line has reached the limit
+char *ReadBuffer::reserve(size_t& bytes)
+{
+  if (this->end - this->start >= this->limit) return nullptr;
+  if (this->end == this->data.size()) {
+    if (this->start > 0) {
+      memmove(this->data.data(), this->data.data() + this->start, this->end - this->start);
+      this->end -= this->start;
+      this->scanned -= this->start;
+      this->start = 0;
+    }
+    if (this->end == this->data.size()) {
+      size_t capacity = std::max<size_t>(READ_BUFFER_MIN, this->data.size() * 2);
+      this->data.resize(std::min(capacity, this->limit + 1));
+    }
+  }
+  bytes = this->data.size() - this->end;
+  return this->data.data() + this->end;
+}
+
+// Marks bytes written into the space returned by reserve as received
+void ReadBuffer::commit(size_t bytes)
+{
+  this->end += bytes;
+}
+
+// Hands out the next complete line, valid until the next call to next or reserve
+bool ReadBuffer::next(const char*& line, size_t& length)
+{
+  const char *base = this->data.data();
+  const char *found = nullptr;
+  if (this->scanned < this->end) found = (const char*) memchr(base + this->scanned, '\n', this->end - this->scanned);
+  if (!found) {
+    this->scanned = this->end;
+    if (this->start == this->end) {
+      this->start = this->end = this->scanned = 0;
+      if (this->data.size() > READ_BUFFER_MIN) std::vector<char>().swap(this->data);
+    }
+    return false;
+  }
+  line = base + this->start;
+  length = found - line;
+  this->start = this->scanned = found - base + 1;
+  return true;
+}
+
+// Returns the size of the partial line waiting for its newline
+size_t ReadBuffer::pending()
+{
+  return this->end - this->start;
+}
+
+// Appends a message. The stall timer starts when the queue goes from empty to non-empty
+void WriteQueue::push(const wire_buffer_t& buffer, bool cosmetic)
+{
+  if (this->entries.empty()) this->progress = std::chrono::steady_clock::now();
+  entry e;
+  e.buffer = buffer;
+  e.cosmetic = cosmetic;
+  this->entries.push_back(e);
+  this->total += buffer->size();
+  if (cosmetic) this->cosmetics++;
+}
+
+// Counts a message that was discarded instead of being queued
+void WriteQueue::drop()
+{
+  this->drops++;
+}
+
+// Discards the queued cosmetic messages that no write has started on, returning how many
+size_t WriteQueue::purge()
+{
+  size_t purged = 0;
+  if (this->cosmetics == 0) return purged;
+  std::deque<entry> kept;
+  for (size_t i = 0; i < this->entries.size(); i++) {
+    entry& e = this->entries[i];
+    bool started = i < this->busy || (i == 0 && (this->offset > 0 || this->pending));
+    if (e.cosmetic && !started) {
+      this->total -= e.buffer->size();
+      this->cosmetics--;
+      purged++;
+    } else {
+      kept.push_back(e);
+    }
+  }
+  this->entries.swap(kept);
+  this->drops += purged;
+  return purged;
+}
+
+// Fills up to max iovecs with the unwritten data, oldest first. Returns the number filled
+int WriteQueue::gather(struct iovec *iov, int max)
+{
+  int count = 0;
+  for (size_t i = this->busy; i < this->entries.size() && count < max; i++) {
+    const string& data = *this->entries[i].buffer;
+    size_t start = i == 0 ? this->offset : 0;
+    iov[count].iov_base = (void*) (data.data() + start);
+    iov[count].iov_len = data.size() - start;
+    count++;
+  }
+  return count;
+}
+
+// Like gather, but keeps the messages from being gathered or purged again until settle is called
+int WriteQueue::claim(struct iovec *iov, int max)
+{
+  int count = this->gather(iov, max);
+  this->busy += count;
+  return count;
+}
+
+// Called once no asynchronous writes are outstanding, making unwritten messages available to claim again
+void WriteQueue::settle()
+{
+  this->busy = 0;
+}
+
+// Marks the oldest message as taken by a write that has to be retried with the same data
+void WriteQueue::retry()
+{
+  this->pending = true;
+}
+
+// Marks bytes as written, releasing every message that has been fully sent
+void WriteQueue::consume(size_t bytes)
+{
+  if (bytes > 0) this->progress = std::chrono::steady_clock::now();
+  this->total -= bytes;
+  while (bytes > 0 && !this->entries.empty()) {
+    size_t remaining = this->entries.front().buffer->size() - this->offset;
+    if (bytes < remaining) {
+      this->offset += bytes;
+      return;
+    }
+    bytes -= remaining;
+    this->offset = 0;
+    this->pending = false;
+    if (this->entries.front().cosmetic) this->cosmetics--;
+    this->entries.pop_front();
+    if (this->busy > 0) this->busy--;
+  }
+}
+
+bool WriteQueue::empty()
+{
+  return this->entries.empty();
+}
+
+// Returns the number of queued messages
+size_t WriteQueue::size()
+{
+  return this->entries.size();
+}
+
+// Returns the number of bytes that have not been written yet
+size_t WriteQueue::bytes()
+{
+  return this->total;
+}
+
+// Returns how many milliseconds the queue has been non-empty without any data being written
+long WriteQueue::stalled()
+{
+  if (this->entries.empty()) return 0;
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - this->progress).count();
+}
+
+// Returns the number of messages discarded by the slow consumer policy
+uint64_t WriteQueue::dropped()
+{
+  return this->drops;
+}
\ No newline at end of file
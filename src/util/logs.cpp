@@ -1,8 +1,207 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <ctime>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <time.h>
 #include "util/logs.hpp"
 
 using namespace balatrogether;
 
-std::mutex logger::stream::mutex;
+namespace balatrogether::logger {
+  struct line {
+    std::ostringstream text;
+    std::ostream *os = nullptr;
+    string color;
+    bool open = false;
+  };
+
+  struct record {
+    struct timespec time;
+    std::ostream *os;
+    string color;
+    string text;
+  };
+
+  // Finished lines of one thread. Only that thread pushes and only the writer pops
+  struct ring {
+    record slots[LOG_RING_SIZE];
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+  };
+
+  class writer {
+    public:
+      writer();
+      ring* attach();
+      void push(ring *r, record& rec);
+      void stop();
+    private:
+      bool drain();
+      bool pending();
+      void loop();
+
+      std::mutex mutex;
+      std::condition_variable ready;
+      std::vector<ring*> rings;
+      std::atomic<bool> sleeping;
+      std::atomic<bool> running;
+      std::thread thread;
+      time_t second;
+      char stamp[32];
+  };
+
+  // Never destroyed, so threads still logging while the process exits do not touch freed memory
+  static writer& output()
+  {
+    static writer *instance = new writer;
+    return *instance;
+  }
+
+  static void shutdown()
+  {
+    output().stop();
+  }
+
+  static thread_local line current;
+  static thread_local ring *local = nullptr;
+}
+
 logger::stream logger::info("[INFO] ", std::cout, "0");
 logger::stream logger::debug("[DEBUG] ", std::cout, "33");
-logger::stream logger::error("[ERROR] ", std::cerr, "31");
\ No newline at end of file
+logger::stream logger::error("[ERROR] ", std::cerr, "31");
+
+logger::writer::writer() : sleeping(false), running(true), second(-1)
+{
+  this->thread = std::thread(&writer::loop, this);
+  std::atexit(shutdown);
+}
+
+// Registers a ring for the calling thread. Rings are kept for the life of the process since lines may still be
+// waiting in them after their thread exits
+logger::ring* logger::writer::attach()
+{
+  ring *r = new ring;
+  std::lock_guard<std::mutex> guard(this->mutex);
+  this->rings.push_back(r);
+  return r;
+}
+
+// Hands a finished line to the writer. If the ring is full the caller waits for room rather than losing the line
+void logger::writer::push(ring *r, record& rec)
+{
+  size_t tail = r->tail.load(std::memory_order_relaxed);
+  while (tail - r->head.load(std::memory_order_acquire) >= LOG_RING_SIZE) {
+    this->ready.notify_one();
+    std::this_thread::yield();
+  }
+  r->slots[tail % LOG_RING_SIZE] = std::move(rec);
+  r->tail.store(tail + 1, std::memory_order_seq_cst);
+  if (this->sleeping.load(std::memory_order_seq_cst)) {
+    std::lock_guard<std::mutex> guard(this->mutex);
+    this->ready.notify_one();
+  }
+}
+
+// Writes out everything queued so far and stops the writer. Called once at exit
+void logger::writer::stop()
+{
+  {
+    std::lock_guard<std::mutex> guard(this->mutex);
+    this->running = false;
+    this->ready.notify_one();
+  }
+  if (this->thread.joinable()) this->thread.join();
+}
+
+// Prints every queued line, reformatting the timestamp at most once per second. Each stream is flushed once per
+// pass instead of once per line
+bool logger::writer::drain()
+{
+  std::vector<ring*> rings;
+  {
+    std::lock_guard<std::mutex> guard(this->mutex);
+    rings = this->rings;
+  }
+  bool out = false, err = false;
+  string text;
+  for (ring *r : rings) {
+    size_t head = r->head.load(std::memory_order_relaxed);
+    size_t tail = r->tail.load(std::memory_order_acquire);
+    for (; head != tail; head++) {
+      record& rec = r->slots[head % LOG_RING_SIZE];
+      if (rec.time.tv_sec != this->second) {
+        this->second = rec.time.tv_sec;
+        struct tm parts;
+        gmtime_r(&this->second, &parts);
+        strftime(this->stamp, sizeof(this->stamp), "%FT%TZ", &parts);
+      }
+      text.clear();
+      text.append("\033[").append(rec.color).append("m[").append(this->stamp).append("] ");
+      text.append(rec.text).append("\033[34m\n");
+      rec.os->write(text.data(), text.size());
+      if (rec.os == &std::cerr) err = true;
+      else out = true;
+      rec.text = string();
+      r->head.store(head + 1, std::memory_order_release);
+    }
+  }
+  if (out) std::cout.flush();
+  if (err) std::cerr.flush();
+  return out || err;
+}
+
+bool logger::writer::pending()
+{
+  for (ring *r : this->rings) {
+    if (r->head.load(std::memory_order_relaxed) != r->tail.load(std::memory_order_seq_cst)) return true;
+  }
+  return false;
+}
+
+// Drains the rings until stopped. When there is nothing to print the writer announces that it is asleep before
+// checking one last time, so a line pushed in between either gets seen or wakes it
+void logger::writer::loop()
+{
+  while (true) {
+    if (this->drain()) continue;
+    std::unique_lock<std::mutex> lock(this->mutex);
+    if (!this->running) break;
+    this->sleeping.store(true, std::memory_order_seq_cst);
+    if (!this->pending()) this->ready.wait_for(lock, std::chrono::milliseconds(LOG_IDLE_MS));
+    this->sleeping.store(false, std::memory_order_relaxed);
+  }
+  this->drain();
+}
+
+// Returns the calling thread's line, starting it with the stream's prefix if it is new
+std::ostream& logger::begin(const string& prefix, std::ostream& os, const string& color)
+{
+  if (!current.open) {
+    current.text.str(string());
+    current.text.clear();
+    current.text.flags(std::ios_base::dec | std::ios_base::skipws);
+    current.text.fill(' ');
+    current.text << prefix;
+    current.os = &os;
+    current.color = color;
+    current.open = true;
+  }
+  return current.text;
+}
+
+// Timestamps the calling thread's line and queues it for the writer
+void logger::end()
+{
+  record rec;
+  clock_gettime(CLOCK_REALTIME_COARSE, &rec.time);
+  rec.os = current.os;
+  rec.color = current.color;
+  rec.text = current.text.str();
+  current.open = false;
+  if (!local) local = output().attach();
+  output().push(local, rec);
+}
@@ -1,11 +1,7 @@
 #include <limits.h>
 #include "util/misc.hpp"
-#include "httplib.h"
 
 using namespace balatrogether;
-using cache_value = std::pair<clock_t, string>;
-
-std::map<steamid_t, cache_value> displayNameCache;
 
 // Returns the directory that the program being executed is in
 string balatrogether::getpath()
@@ -16,33 +12,24 @@ string balatrogether::getpath()
   return path.substr(0, path.find_last_of('/'));
 }
 
-// Given a player authentication struct, return the display name associated with the Steam ID
-string balatrogether::getplayername(player_auth &auth)
+// Parses an unsigned 64-bit integer written in canonical decimal form, as the server writes IDs into JSON.
+// Returns false for anything else, including leading zeros
+bool balatrogether::parsedecimal(const string& str, uint64_t& value)
 {
-  if (auth.fetchKey.size() == 0) throw std::runtime_error("No Steam API key");
-  std::map<steamid_t, cache_value> newCache;
-  string name;
-  for (auto p : displayNameCache) {
-    if ((clock() - p.second.first) / CLOCKS_PER_SEC < 60) {
-      newCache.insert(p);
-    } else {
-      continue;
-    }
-    if (p.first == auth.steamId) {
-      name = p.second.second;
-    }
+  if (str.empty() || str.size() > 20 || (str.size() > 1 && str[0] == '0')) return false;
+  uint64_t result = 0;
+  for (char ch : str) {
+    if (ch < '0' || ch > '9') return false;
+    uint64_t digit = ch - '0';
+    if (result > (UINT64_MAX - digit) / 10) return false;
+    result = result * 10 + digit;
   }
-  displayNameCache = newCache;
+  value = result;
+  return true;
+}
 
-  if (name.size() == 0) {
-    httplib::Client http("http://api.steampowered.com");
-    httplib::Result res = http.Get("/ISteamUser/GetPlayerSummaries/v0002/?key=" + auth.fetchKey + "&steamids=" + auth.steamId);
-    if (res && res->status >= 200 && res->status < 300) {
-      json body = json::parse(res->body);
-      name = body["response"]["players"][0]["personaname"].get<string>();
-      displayNameCache.insert(std::make_pair(auth.steamId, cache_value(clock(), name)));
-    }
-  }
-  
-  return name;
+// Parses a Steam ID written in canonical decimal form
+bool balatrogether::parsesteamid(const string& str, steamid_t& id)
+{
+  return parsedecimal(str, id);
 }
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <unordered_map>
+#include "util/request.hpp"
+
+using namespace balatrogether;
+
+// Commands that carry more than a few scalars. Anything else gets the default limits. Jokers and cards are
+// forwarded as the client sent them, so these leave room for the mod's own fields: 32 jokers with nested ability
+// tables come to about 7 KB at depth 5, and adding a 300 card deck brings it to about 34 KB
+static const std::unordered_map<string, request::limits> command_limits = {
+  {"SWAP_JOKERS", {65536, 8, 256}},
+  {"GET_CARDS_AND_JOKERS", {262144, 8, 1024}},
+};
+
+static const request::limits default_limits = {REQUEST_MAX_BYTES, REQUEST_MAX_DEPTH, REQUEST_MAX_ELEMENTS};
+
+// The limits in force until the command is known, loose enough for every command
+static request::limits widest_limits()
+{
+  request::limits widest = default_limits;
+  for (auto& entry : command_limits) {
+    widest.bytes = std::max(widest.bytes, entry.second.bytes);
+    widest.depth = std::max(widest.depth, entry.second.depth);
+    widest.elements = std::max(widest.elements, entry.second.elements);
+  }
+  return widest;
+}
+
+static const request::limits any_limits = widest_limits();
+
+// Builds the request through nlohmann's DOM parser while counting what it contains, and stops the parse as soon
+// as the request grows past its limits. Until the top-level cmd has been read the widest limits apply; once it
+// has, the command's own limits are checked against everything seen so far and enforced from then on
+class limited_sax {
+  public:
+    using number_integer_t = json::number_integer_t;
+    using number_unsigned_t = json::number_unsigned_t;
+    using number_float_t = json::number_float_t;
+    using string_t = json::string_t;
+    using binary_t = json::binary_t;
+
+    limited_sax(json& result, size_t length) : dom(result, false), length(length), active(&any_limits), tooLarge(false), command(false), deepest(0), largest(0) {};
+
+    bool null() { return this->value() && this->dom.null(); };
+    bool boolean(bool val) { return this->value() && this->dom.boolean(val); };
+    bool number_integer(number_integer_t val) { return this->value() && this->dom.number_integer(val); };
+    bool number_unsigned(number_unsigned_t val) { return this->value() && this->dom.number_unsigned(val); };
+    bool number_float(number_float_t val, const string_t& s) { return this->value() && this->dom.number_float(val, s); };
+    bool binary(binary_t& val) { return this->value() && this->dom.binary(val); };
+
+    bool string(string_t& val)
+    {
+      bool isCommand = this->command;
+      if (!this->value()) return false;
+      if (isCommand && !this->apply(request::getLimits(val))) return false;
+      return this->dom.string(val);
+    };
+
+    bool start_object(std::size_t elements)
+    {
+      if (!this->value() || !this->open(false)) return false;
+      return this->dom.start_object(elements);
+    };
+
+    bool key(string_t& val)
+    {
+      if (!this->count()) return false;
+      this->command = this->containers.size() == 1 && val == "cmd";
+      return this->dom.key(val);
+    };
+
+    bool end_object()
+    {
+      this->containers.pop_back();
+      return this->dom.end_object();
+    };
+
+    bool start_array(std::size_t elements)
+    {
+      if (!this->value() || !this->open(true)) return false;
+      return this->dom.start_array(elements);
+    };
+
+    bool end_array()
+    {
+      this->containers.pop_back();
+      return this->dom.end_array();
+    };
+
+    bool parse_error(std::size_t position, const std::string& last_token, const nlohmann::detail::exception& ex)
+    {
+      return this->dom.parse_error(position, last_token, ex);
+    };
+
+    bool isTooLarge() { return this->tooLarge; };
+  private:
+    struct container {
+      bool array;
+      size_t elements;
+    };
+
+    // Called before every value. Values directly inside an array count towards its elements
+    bool value()
+    {
+      this->command = false;
+      if (this->containers.empty() || !this->containers.back().array) return true;
+      return this->count();
+    };
+
+    bool count()
+    {
+      size_t elements = ++this->containers.back().elements;
+      this->largest = std::max(this->largest, elements);
+      return this->check(elements <= this->active->elements);
+    };
+
+    bool open(bool array)
+    {
+      this->containers.push_back(container{array, 0});
+      this->deepest = std::max(this->deepest, this->containers.size());
+      return this->check(this->containers.size() <= this->active->depth);
+    };
+
+    bool apply(const request::limits& limits)
+    {
+      this->active = &limits;
+      return this->check(this->length <= limits.bytes && this->deepest <= limits.depth && this->largest <= limits.elements);
+    };
+
+    bool check(bool ok)
+    {
+      if (!ok) this->tooLarge = true;
+      return ok;
+    };
+
+    nlohmann::detail::json_sax_dom_parser<json> dom;
+    std::vector<container> containers;
+    size_t length;
+    const request::limits *active;
+    bool tooLarge;
+    bool command;
+    size_t deepest;
+    size_t largest;
+};
+
+// Parses a single request, giving up as soon as it breaks its command's limits. The result is only valid if the
+// request parsed successfully
+request::parse_status_t request::parse(const char* data, size_t length, json& result)
+{
+  if (length > any_limits.bytes) return PARSE_TOO_LARGE;
+  limited_sax sax(result, length);
+  bool parsed = false;
+  try {
+    parsed = json::sax_parse(data, data + length, &sax);
+  } catch (...) {
+    parsed = false;
+  }
+  if (sax.isTooLarge()) return PARSE_TOO_LARGE;
+  return parsed ? PARSE_OK : PARSE_INVALID;
+}
+
+// Returns the size limits for a command
+const request::limits& request::getLimits(const string& cmd)
+{
+  auto it = command_limits.find(cmd);
+  if (it == command_limits.end()) return default_limits;
+  return it->second;
+}
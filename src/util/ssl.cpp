@@ -147,4 +147,7 @@ void ssl::configure_context(SSL_CTX *ctx, bool debugMode)
   
   EVP_PKEY_free(pkey);
   X509_free(x509);
+
+  /* Let writes complete partially, and resume from a different address after the queue has moved. */
+  SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
 }
\ No newline at end of file
@@ -1,8 +1,24 @@
+#include <array>
 #include <regex>
 #include "util/validation.hpp"
+#include "util/misc.hpp"
 
 using namespace balatrogether;
 
+static std::array<bool, 256> base64_table()
+{
+  std::array<bool, 256> table = {};
+  for (int c = 'A'; c <= 'Z'; c++) table[c] = true;
+  for (int c = 'a'; c <= 'z'; c++) table[c] = true;
+  for (int c = '0'; c <= '9'; c++) table[c] = true;
+  table['+'] = true;
+  table['/'] = true;
+  return table;
+}
+
+// Characters allowed in base64 before any padding
+static const std::array<bool, 256> base64_chars = base64_table();
+
 bool validation::string(json& data)
 {
   return data.is_string();
@@ -16,16 +32,15 @@ bool validation::string(json& data, size_t maxLength)
 bool validation::string(json& data, size_t minLength, size_t maxLength)
 {
   if (!validation::string(data)) return false;
-  balatrogether::string str = data.get<balatrogether::string>();
-  if (str.size() < minLength || str.size() > maxLength) return false;
-  return true;
+  size_t length = data.get_ref<const balatrogether::string&>().size();
+  return length >= minLength && length <= maxLength;
 }
 
 bool validation::string(json &data, const char *regex)
 {
   if (!validation::string(data)) return false;
   std::regex expr(regex);
-  return std::regex_search(data.get<balatrogether::string>(), expr);
+  return std::regex_search(data.get_ref<const balatrogether::string&>(), expr);
 }
 
 bool validation::integer(json &data, int min, int max)
@@ -51,14 +66,23 @@ bool validation::boolean(json &data)
 
 bool validation::steamid(json& data)
 {
-  if (!validation::string(data, 32)) return false;
-  steamid_t str = data.get<steamid_t>();
-  uint64_t num = strtoull(str.c_str(), nullptr, 10);
-  if (std::to_string(num) != str) return false;
-  return true;
+  if (!validation::string(data)) return false;
+  steamid_t id;
+  return parsesteamid(data.get_ref<const balatrogether::string&>(), id);
 }
 
+// Accepts padded base64: whole groups of four characters, where the last group may end in one or two '='
 bool validation::base64(json& data)
 {
-  return validation::string(data, "^(?:[A-Za-z0-9+/]{4})*(?:[A-Za-z0-9+/]{2}==|[A-Za-z0-9+/]{3}=)?$");
+  if (!validation::string(data)) return false;
+  const balatrogether::string& str = data.get_ref<const balatrogether::string&>();
+  size_t length = str.size();
+  if (length % 4 != 0) return false;
+  size_t end = length;
+  if (end > 0 && str[end - 1] == '=') end--;
+  if (end > 0 && str[end - 1] == '=') end--;
+  for (size_t i = 0; i < end; i++) {
+    if (!base64_chars[(unsigned char) str[i]]) return false;
+  }
+  return true;
 }
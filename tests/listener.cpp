@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <random>
+#include "test.hpp"
+#include "listeners/lobby.hpp"
+#include "listeners/server.hpp"
+#include "lobby.hpp"
+
+using namespace balatrogether;
+
+struct target {
+  std::vector<string> calls;
+};
+typedef target* target_t;
+
+// Records each command it runs, or fails the way the request asks it to
+class RecordingEvent : public Event<target_t> {
+  public:
+    RecordingEvent(string command) : Event(command) {};
+    void execute(target_t object, client_t client, json& req)
+    {
+      if (req["fail"] == "keep") throw client_exception("Kept");
+      if (req["fail"] == "disconnect") throw client_exception("Disconnected", true);
+      if (req["fail"] == "other") throw std::runtime_error("Failed");
+      object->calls.push_back(this->getCommand());
+    };
+};
+
+class RecordingListener : public EventListener<target_t> {
+  public:
+    RecordingListener(target_t object) : EventListener(object), errors(0) {};
+    bool resume(target_t object, client_t client, json& req) { return req.contains("request_id"); };
+    void client_error(target_t object, client_t client, json& req, client_exception& e) { errors.push_back(e.what()); };
+    std::vector<string> errors;
+};
+
+// Exposes the events a listener has registered
+template <typename L>
+class Registered : public L {
+  public:
+    using L::L;
+    using L::events;
+};
+
+static json request(const string& cmd)
+{
+  json req;
+  req["cmd"] = cmd;
+  return req;
+}
+
+// Commands registered in any order are all found, and nothing else is
+static void lookup()
+{
+  std::vector<string> commands;
+  for (int i = 0; i < 40; i++) commands.push_back("CMD_" + std::to_string(i * 7 % 40));
+  std::shuffle(commands.begin(), commands.end(), std::mt19937(1));
+
+  target object;
+  RecordingListener listener(&object);
+  for (const string& command : commands) listener.add(new RecordingEvent(command));
+  for (const string& command : commands) {
+    CHECK(listener.find(command) && listener.find(command)->getCommand() == command);
+  }
+  CHECK(!listener.find(""));
+  CHECK(!listener.find("CMD_"));
+  CHECK(!listener.find("CMD_399"));
+  CHECK(!listener.find("AAA"));
+  CHECK(!listener.find("ZZZ"));
+}
+
+// Requests run the event for their command, and each kind of failure is reported the same way as before
+static void processing()
+{
+  target object;
+  RecordingListener listener(&object);
+  listener.add(new RecordingEvent("PLAY_HAND"));
+  listener.add(new RecordingEvent("DISCARD"));
+
+  json req = request("DISCARD");
+  CHECK(listener.process(nullptr, req));
+  req = request("PLAY_HAND");
+  CHECK(listener.process(nullptr, req));
+  CHECK(object.calls == std::vector<string>({"DISCARD", "PLAY_HAND"}));
+
+  req = request("REROLL");
+  CHECK(!listener.process(nullptr, req));
+  req = json::object();
+  CHECK(!listener.process(nullptr, req));
+  req["cmd"] = 1;
+  CHECK(!listener.process(nullptr, req));
+
+  req = request("DISCARD");
+  req["fail"] = "keep";
+  CHECK(listener.process(nullptr, req));
+  req["fail"] = "disconnect";
+  CHECK(!listener.process(nullptr, req));
+  req["fail"] = "other";
+  CHECK(!listener.process(nullptr, req));
+  CHECK(listener.errors == std::vector<string>({"Kept", "Disconnected"}));
+
+  req = request("DISCARD");
+  req["request_id"] = "1";
+  CHECK(listener.process(nullptr, req));
+  CHECK(object.calls.size() == 2);
+}
+
+// Every event the server registers can be reached through the table
+static void registered()
+{
+  Registered<LobbyEventListener> lobby;
+  CHECK(lobby.events.size() > 0);
+  for (auto event : lobby.events) CHECK(lobby.find(event->getCommand()) == event);
+
+  Registered<ServerEventListener> server(nullptr);
+  CHECK(server.events.size() > 0);
+  for (auto event : server.events) CHECK(server.find(event->getCommand()) == event);
+}
+
+static bool joinLobby(test::Connection& c, steamid_t steamId, int number)
+{
+  json req = test::joinRequest(steamId, "JOIN_LOBBY");
+  req["number"] = number;
+  return c.send(req) && c.expect("JOIN");
+}
+
+// Every lobby runs the server's one set of events, which act on the lobby they are given: the same HIGHLIGHT event
+// is relayed in a co-op lobby, and in a versus one drops its sender
+static void shared()
+{
+  int port;
+  server_t server = test::startServer({{"max_players", 2}, {"max_lobbies", 2}}, port);
+  for (lobby_t lobby : server->getLobbies()) CHECK(lobby->getEventListener() == server->getLobbyEventListener());
+
+  test::Connection a(port), b(port), c(port), d(port);
+  CHECK(joinLobby(a, 76561198000000001, 1) && joinLobby(b, 76561198000000002, 1));
+  CHECK(joinLobby(c, 76561198000000003, 2) && joinLobby(d, 76561198000000004, 2));
+  CHECK(a.send(test::startRequest(false)) && a.expect("START") && b.expect("START"));
+  CHECK(c.send(test::startRequest(true)) && c.expect("START") && d.expect("START"));
+
+  json req;
+  req["cmd"] = "HIGHLIGHT";
+  req["type"] = "hand";
+  req["index"] = 1;
+  json res;
+  CHECK(a.send(req) && b.expect("HIGHLIGHT", res) && res["data"]["index"] == 1);
+  CHECK(c.send(req) && d.receive(res) && res["cmd"] == "LEAVE");
+}
+
+int main()
+{
+  lookup();
+  processing();
+  registered();
+  shared();
+  test::finish();
+}
@@ -0,0 +1,89 @@
+#include <atomic>
+#include <vector>
+#include "test.hpp"
+#include "lobby.hpp"
+
+#define LOBBIES 16
+#define EVENTS 500
+#define CHURN_LOBBY (LOBBIES + 1)
+
+using namespace balatrogether;
+
+static std::atomic<int> failedLobbies(0);
+
+static json highlight(int lobby, int index)
+{
+  json req;
+  req["cmd"] = "HIGHLIGHT";
+  req["type"] = "lobby" + std::to_string(lobby);
+  req["index"] = index;
+  return req;
+}
+
+// Reads the other player's events, which must all be from this lobby and in the order they were sent
+static bool receiveAll(test::Connection& c, int lobby)
+{
+  for (int i = 0; i < EVENTS; i++) {
+    json res;
+    if (!c.expect("HIGHLIGHT", res)) return false;
+    if (res["data"]["type"] != "lobby" + std::to_string(lobby) || res["data"]["index"] != i) return false;
+  }
+  return true;
+}
+
+// Both players of a lobby send events at the same time as every other lobby
+static void play(int port, int lobby)
+{
+  test::Connection a(port), b(port);
+  json req = test::joinRequest(76561198000000000 + lobby * 2, "JOIN_LOBBY");
+  req["number"] = lobby;
+  bool ok = a.send(req) && a.expect("JOIN");
+  req = test::joinRequest(76561198000000001 + lobby * 2, "JOIN_LOBBY");
+  req["number"] = lobby;
+  ok = ok && b.send(req) && b.expect("JOIN") && a.expect("JOIN");
+  ok = ok && a.send(test::startRequest()) && a.expect("START") && b.expect("START");
+
+  for (int i = 0; i < EVENTS && ok; i++) ok = a.send(highlight(lobby, i)) && b.send(highlight(lobby, i));
+  ok = ok && receiveAll(a, lobby) && receiveAll(b, lobby);
+  if (!ok) failedLobbies++;
+}
+
+// Players keep joining and leaving one lobby while the others are busy
+static void churn(server_t server, int port, std::atomic<bool>& running, std::atomic<int>& joins)
+{
+  lobby_t lobby = server->getLobby(CHURN_LOBBY);
+  for (int i = 0; running; i++) {
+    test::Connection c(port);
+    json req = test::joinRequest(76561198100000000 + i, "JOIN_LOBBY");
+    req["number"] = CHURN_LOBBY;
+    if (c.send(req) && c.expect("JOIN")) joins++;
+    c.close();
+    test::waitFor([lobby]() { return lobby->getClients().empty(); });
+  }
+}
+
+// Lobbies run on several executor workers while the server lock is taken from outside, as the console does
+int main()
+{
+  int port;
+  server_t server = test::startServer({{"max_players", 2}, {"max_lobbies", CHURN_LOBBY}, {"io_threads", 4}, {"lobby_workers", 4}}, port);
+
+  std::atomic<bool> running(true);
+  std::atomic<int> joins(0);
+  std::thread churner(churn, server, port, std::ref(running), std::ref(joins));
+  std::thread console([server, &running]() {
+    while (running) test::clientCount(server);
+  });
+
+  std::vector<std::thread> players;
+  for (int lobby = 1; lobby <= LOBBIES; lobby++) players.push_back(std::thread(play, port, lobby));
+  for (std::thread& t : players) t.join();
+  running = false;
+  churner.join();
+  console.join();
+
+  CHECK(failedLobbies == 0);
+  CHECK(joins > 0);
+  CHECK(test::waitFor([server]() { return test::clientCount(server) == 0; }));
+  test::finish();
+}
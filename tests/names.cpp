@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include "httplib.h"
+#include "test.hpp"
+#include "names.hpp"
+
+#define FIRST_ID 76561198000000000
+#define BATCH_IDS 250
+#define API_KEY "test"
+
+using namespace balatrogether;
+
+// Stands in for the Steam Web API, naming every ID it is asked about and recording the size of each batch. The
+// first request can be held back so that lookups pile up behind it, and every request can be made to fail
+class SteamStub {
+  public:
+    SteamStub() : hold(false), failing(false)
+    {
+      this->http.Get("/ISteamUser/GetPlayerSummaries/v0002/", [this](const httplib::Request& req, httplib::Response& res) {
+        while (this->hold) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::vector<string> ids;
+        string list = req.get_param_value("steamids");
+        for (size_t start = 0, end; start < list.size(); start = end + 1) {
+          end = std::min(list.find(',', start), list.size());
+          ids.push_back(list.substr(start, end - start));
+        }
+        {
+          std::lock_guard<std::mutex> guard(this->mutex);
+          this->batches.push_back(ids.size());
+          if (req.get_param_value("key") != API_KEY) this->badKeys++;
+        }
+        if (this->failing) {
+          res.status = 500;
+          return;
+        }
+        json body;
+        body["response"]["players"] = json::array();
+        for (string& id : ids) body["response"]["players"].push_back({{"steamid", id}, {"personaname", "name" + id}});
+        res.set_content(body.dump(), "application/json");
+      });
+      this->port = test::freePort();
+      this->http.bind_to_port("127.0.0.1", this->port);
+      this->thread = std::thread([this]() { this->http.listen_after_bind(); });
+      this->http.wait_until_ready();
+    };
+
+    ~SteamStub()
+    {
+      this->http.stop();
+      this->thread.join();
+    };
+
+    string url()
+    {
+      return "http://127.0.0.1:" + std::to_string(this->port);
+    };
+
+    std::vector<size_t> requests()
+    {
+      std::lock_guard<std::mutex> guard(this->mutex);
+      return this->batches;
+    };
+
+    std::atomic<bool> hold;
+    std::atomic<bool> failing;
+    int badKeys = 0;
+  private:
+    httplib::Server http;
+    std::thread thread;
+    std::mutex mutex;
+    std::vector<size_t> batches;
+    int port;
+};
+
+static string expected(steamid_t steamId)
+{
+  return "name" + std::to_string(steamId);
+}
+
+// IDs looked up while a request is in flight are fetched together, at most a hundred at a time
+static void batching(SteamStub& stub, name_resolver_t names)
+{
+  stub.hold = true;
+  for (int i = 0; i < BATCH_IDS; i++) CHECK(names->lookup(FIRST_ID + i) == "");
+  stub.hold = false;
+  CHECK(test::waitFor([names]() { return names->lookup(FIRST_ID + BATCH_IDS - 1) != ""; }));
+
+  std::vector<size_t> batches = stub.requests();
+  size_t total = 0;
+  for (size_t size : batches) total += size;
+  CHECK(total == BATCH_IDS);
+  CHECK(batches.size() <= 4);
+  CHECK(*std::max_element(batches.begin(), batches.end()) == NAME_BATCH_SIZE);
+  for (int i = 0; i < BATCH_IDS; i++) CHECK(names->lookup(FIRST_ID + i) == expected(FIRST_ID + i));
+}
+
+static bool playerNames(json& res, std::vector<string> names)
+{
+  if (!res["data"]["players"].is_array() || res["data"]["players"].size() != names.size()) return false;
+  for (size_t i = 0; i < names.size(); i++) {
+    if (res["data"]["players"][i]["name"] != names[i]) return false;
+  }
+  return true;
+}
+
+// Players join without a name, and their lobby is sent the player list again once it arrives. A name that is
+// already cached is known when the player joins
+static void players(int port)
+{
+  steamid_t first = FIRST_ID + BATCH_IDS, second = FIRST_ID + BATCH_IDS + 1;
+  test::Connection a(port), b(port), c(port);
+  json res;
+  CHECK(a.send(test::joinRequest(first)) && a.expect("JOIN", res) && playerNames(res, {""}));
+  CHECK(a.expect("PLAYERS", res) && playerNames(res, {expected(first)}));
+  CHECK(b.send(test::joinRequest(second)) && b.expect("JOIN", res) && playerNames(res, {expected(first), ""}));
+  CHECK(b.expect("PLAYERS", res) && playerNames(res, {expected(first), expected(second)}));
+  CHECK(a.expect("PLAYERS", res) && playerNames(res, {expected(first), expected(second)}));
+  CHECK(c.send(test::joinRequest(FIRST_ID)) && c.expect("JOIN", res));
+  CHECK(playerNames(res, {expected(first), expected(second), expected(FIRST_ID)}));
+}
+
+// After repeated failures the API is left alone until the cooldown ends, then a single request is let through
+static void breaker(SteamStub& stub, name_resolver_t names)
+{
+  steamid_t steamId = FIRST_ID + BATCH_IDS + 2;
+  size_t before = stub.requests().size();
+  stub.failing = true;
+  CHECK(names->lookup(steamId) == "");
+  CHECK(test::waitFor([&stub, before]() { return stub.requests().size() == before + NAME_BREAKER_FAILURES; }));
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  CHECK(stub.requests().size() == before + NAME_BREAKER_FAILURES);
+
+  stub.failing = false;
+  CHECK(test::waitFor([names, steamId]() { return names->lookup(steamId) != ""; }, (NAME_BREAKER_COOLDOWN_S + 5) * 1000));
+  CHECK(names->lookup(steamId) == expected(steamId));
+  CHECK(stub.requests().size() == before + NAME_BREAKER_FAILURES + 1);
+}
+
+// Stopping the resolver writes every name it knows, which a new cache reads back with the most recent kept
+static void snapshot(name_resolver_t names)
+{
+  names->stop();
+  string path = getpath() + "/" + NAME_CACHE_FILE;
+  NameCache cache(1000, 3600);
+  CHECK(cache.load(path));
+  CHECK(cache.size() == BATCH_IDS + 3);
+  string name;
+  for (steamid_t id = FIRST_ID; id < FIRST_ID + BATCH_IDS + 3; id++) CHECK(cache.get(id, name) && name == expected(id));
+
+  NameCache small(10, 3600);
+  CHECK(small.load(path) && small.size() == 10);
+  CHECK(small.get(FIRST_ID + BATCH_IDS + 2, name) && name == expected(FIRST_ID + BATCH_IDS + 2));
+  CHECK(!small.get(FIRST_ID + 1, name));
+}
+
+int main()
+{
+  remove((getpath() + "/" + NAME_CACHE_FILE).c_str());
+  SteamStub stub;
+  int port;
+  server_t server = test::startServer({{"steam_api_key", API_KEY}, {"steam_api_url", stub.url()}, {"steam_api_workers", 1}}, port);
+  name_resolver_t names = server->getNameResolver();
+  CHECK(names != nullptr);
+
+  batching(stub, names);
+  players(port);
+  breaker(stub, names);
+  snapshot(names);
+  CHECK(stub.badKeys == 0);
+  test::finish();
+}
@@ -0,0 +1,85 @@
+#include <memory>
+#include <vector>
+#include "test.hpp"
+#include "reactors/uring.hpp"
+
+#define CLIENTS 256
+#define LOBBIES 64
+#define LOBBY_SIZE (CLIENTS / LOBBIES)
+
+using namespace balatrogether;
+
+typedef std::unique_ptr<test::Connection> connection_t;
+
+// Clients join every lobby at once, spread across the backend's event loops, and each lobby sees all of its players. The
+// first wave is waited on so that client n hosts lobby n + 1
+static void joinLobbies(server_t server, std::vector<connection_t>& clients)
+{
+  for (int i = 0; i < CLIENTS; i++) {
+    json req = test::joinRequest(76561198000000000 + i, "JOIN_LOBBY");
+    req["number"] = i % LOBBIES + 1;
+    CHECK(clients[i]->send(req));
+    if (i == LOBBIES - 1) {
+      for (int host = 0; host < LOBBIES; host++) CHECK(clients[host]->expect("JOIN"));
+    }
+  }
+  for (int i = 0; i < CLIENTS; i++) {
+    json res;
+    bool full = false;
+    while (!full && clients[i]->expect("JOIN", res)) full = res["data"]["players"].size() == LOBBY_SIZE;
+    CHECK(full);
+  }
+  CHECK(test::clientCount(server) == CLIENTS);
+}
+
+// Requests that arrive split across reads and several to a read are all framed and answered in order
+static void framing(std::vector<connection_t>& clients)
+{
+  for (int lobby = 0; lobby < LOBBIES; lobby++) CHECK(clients[lobby]->send(test::startRequest()));
+  for (int i = 0; i < CLIENTS; i++) CHECK(clients[i]->expect("START"));
+
+  string first = "{\"cmd\":\"HIGHLIGHT\",\"type\":\"hand\",\"index\":1}\n{\"cmd\":\"HIGHLIGHT\",\"ty";
+  string second = "pe\":\"hand\",\"index\":2}\n";
+  for (int lobby = 0; lobby < LOBBIES; lobby++) CHECK(clients[lobby]->sendRaw(first));
+  for (int lobby = 0; lobby < LOBBIES; lobby++) CHECK(clients[lobby]->sendRaw(second));
+  for (int i = LOBBIES; i < CLIENTS; i++) {
+    json res;
+    CHECK(clients[i]->expect("HIGHLIGHT", res) && res["data"]["index"] == 1);
+    CHECK(clients[i]->expect("HIGHLIGHT", res) && res["data"]["index"] == 2);
+  }
+}
+
+// Clients that go away are released by their event loop, and the rest of their lobby is told
+static void disconnects(server_t server, std::vector<connection_t>& clients)
+{
+  for (int i = 0; i < CLIENTS / 2; i++) clients[i]->close();
+  CHECK(test::waitFor([server]() { return test::clientCount(server) == CLIENTS / 2; }));
+  for (int i = CLIENTS / 2; i < CLIENTS; i++) CHECK(clients[i]->expect("LEAVE"));
+
+  for (int i = CLIENTS / 2; i < CLIENTS; i++) clients[i]->close();
+  CHECK(test::waitFor([server]() { return test::clientCount(server) == 0; }));
+}
+
+// Runs every case on a new server using the given I/O backend
+static void backend(const string& name)
+{
+  int port;
+  server_t server = test::startServer({{"max_players", LOBBY_SIZE}, {"max_lobbies", LOBBIES}, {"io_threads", 4}, {"io_backend", name}}, port);
+
+  std::vector<connection_t> clients;
+  for (int i = 0; i < CLIENTS; i++) {
+    clients.push_back(connection_t(new test::Connection(port)));
+    CHECK(clients.back()->isConnected());
+  }
+  joinLobbies(server, clients);
+  framing(clients);
+  disconnects(server, clients);
+}
+
+int main()
+{
+  backend("epoll");
+  if (UringReactor::isSupported()) backend("io_uring");
+  else std::printf("io_uring is not supported here, skipping it\n");
+  test::finish();
+}
@@ -0,0 +1,68 @@
+#include <memory>
+#include <vector>
+#include "test.hpp"
+#include "client.hpp"
+#include "player.hpp"
+
+#define CLIENTS 64
+#define FIRST_ID ((steamid_t) 76561198000000000)
+
+using namespace balatrogether;
+
+typedef std::unique_ptr<test::Connection> connection_t;
+
+// Every connected player can be found by Steam ID, and every ID that has left cannot
+static bool consistent(server_t server, const std::vector<connection_t>& clients)
+{
+  bool ok = true;
+  size_t connected = 0;
+  server->lock();
+  for (int i = 0; i < CLIENTS; i++) {
+    client_t c = server->getClient(FIRST_ID + i);
+    if (clients[i]) {
+      connected++;
+      ok = ok && c && c->getPlayer() && c->getPlayer()->getSteamId() == FIRST_ID + i;
+    } else {
+      ok = ok && !c;
+    }
+  }
+  for (client_t c : server->getClients()) ok = ok && server->getClient(c->getPlayer()->getSteamId()) == c;
+  ok = ok && server->getClients().size() == connected;
+  server->unlock();
+  return ok;
+}
+
+static bool join(std::vector<connection_t>& clients, int port, int i)
+{
+  clients[i].reset(new test::Connection(port));
+  return clients[i]->send(test::joinRequest(FIRST_ID + i)) && clients[i]->expect("JOIN");
+}
+
+// Players leave from every position in the client list, which moves the last client into their place
+int main()
+{
+  int port;
+  server_t server = test::startServer({{"max_players", CLIENTS}}, port);
+
+  std::vector<connection_t> clients(CLIENTS);
+  for (int i = 0; i < CLIENTS; i++) CHECK(join(clients, port, i));
+  CHECK(consistent(server, clients));
+
+  test::Connection duplicate(port);
+  CHECK(duplicate.send(test::joinRequest(FIRST_ID + 5)));
+  json res;
+  CHECK(duplicate.receive(res) && res["success"] == false);
+  CHECK(consistent(server, clients));
+
+  for (int i = 0; i < CLIENTS; i += 3) clients[i].reset();
+  clients[CLIENTS - 1].reset();
+  CHECK(test::waitFor([server, &clients]() { return consistent(server, clients); }));
+
+  for (int i = 0; i < CLIENTS; i += 6) CHECK(join(clients, port, i));
+  CHECK(consistent(server, clients));
+
+  for (connection_t& c : clients) c.reset();
+  CHECK(test::waitFor([server, &clients]() { return consistent(server, clients); }));
+  CHECK(test::clientCount(server) == 0);
+  test::finish();
+}
@@ -0,0 +1,64 @@
+#include <random>
+#include "test.hpp"
+#include "preq.hpp"
+
+#define CARDS 100
+#define TRIALS 20000
+
+// Chi-square critical values at p = 0.001
+#define CHI_SQUARE_99 148.23
+
+using namespace balatrogether;
+
+static double chiSquare(const std::vector<long>& counts, double expected)
+{
+  double sum = 0;
+  for (long count : counts) sum += (count - expected) * (count - expected) / expected;
+  return sum;
+}
+
+// Offers a deck of numbered cards to a new request and returns what it draws
+static std::vector<json> draw(PersistentRequestManager& manager, std::mt19937& random, int cards)
+{
+  preq_t preq = manager.create("GET_CARDS_AND_JOKERS", 0, nullptr, nullptr, nullptr);
+  for (int i = 0; i < cards; i++) {
+    json card;
+    card["k"] = "c_base";
+    card["id"] = i;
+    preq->addCard(card, random);
+  }
+  return preq->drawCards(random);
+}
+
+// Every card is equally likely to be sampled, and equally likely to be drawn first
+int main()
+{
+  PersistentRequestManager manager;
+  std::mt19937 random(1);
+
+  std::vector<json> few = draw(manager, random, PREQ_CARD_SAMPLE / 2);
+  CHECK(few.size() == PREQ_CARD_SAMPLE / 2);
+
+  std::vector<long> sampled(CARDS), first(CARDS);
+  for (int trial = 0; trial < TRIALS; trial++) {
+    std::vector<json> cards = draw(manager, random, CARDS);
+    CHECK(cards.size() == PREQ_CARD_SAMPLE);
+    std::vector<bool> seen(CARDS);
+    for (json& card : cards) {
+      int id = card["id"].get<int>();
+      CHECK(!seen[id]);
+      seen[id] = true;
+      sampled[id]++;
+    }
+    first[cards[0]["id"].get<int>()]++;
+  }
+
+  double inclusion = chiSquare(sampled, (double) TRIALS * PREQ_CARD_SAMPLE / CARDS);
+  std::printf("inclusion chi-square %.1f with %d degrees of freedom\n", inclusion, CARDS - 1);
+  CHECK(inclusion < CHI_SQUARE_99);
+
+  double order = chiSquare(first, (double) TRIALS / CARDS);
+  std::printf("first card chi-square %.1f with %d degrees of freedom\n", order, CARDS - 1);
+  CHECK(order < CHI_SQUARE_99);
+  test::finish();
+}
@@ -0,0 +1,239 @@
+#ifndef BALATROGETHER_TEST_H
+#define BALATROGETHER_TEST_H
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <poll.h>
+#include <openssl/ssl.h>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <thread>
+#include "util/logs.hpp"
+#include "util/misc.hpp"
+#include "server.hpp"
+
+#define CHECK(cond) balatrogether::test::check((cond), #cond, __FILE__, __LINE__)
+
+// Helpers shared by the test programs. Each program runs its cases from main and ends with test::finish(). Tests
+// that need a server start a real one in process on a free port, with its config written next to the test binary,
+// and talk to it over sockets the way the game does
+namespace balatrogether::test {
+  static int failures = 0;
+  static int checks = 0;
+
+  inline bool check(bool ok, const char* expr, const char* file, int line)
+  {
+    checks++;
+    if (!ok) {
+      failures++;
+      std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+    }
+    return ok;
+  }
+
+  // Reports the result and exits without tearing down servers that are still running
+  inline void finish()
+  {
+    std::printf("%d checks, %d failed\n", checks, failures);
+    std::fflush(stdout);
+    std::fflush(stderr);
+    _exit(failures == 0 ? 0 : 1);
+  }
+
+  inline int freePort()
+  {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    bind(fd, (struct sockaddr*) &addr, len);
+    getsockname(fd, (struct sockaddr*) &addr, &len);
+    close(fd);
+    return ntohs(addr.sin_port);
+  }
+
+  // Starts a server with the given config on top of the defaults. The console reads from a pipe that is never
+  // written, so it stays idle. Server logs on standard output are dropped, and test results are reported through
+  // stdio instead
+  inline server_t startServer(json overrides, int& port)
+  {
+    json config = {
+      {"max_players", 8},
+      {"max_lobbies", 1},
+      {"tls_enabled", false},
+      {"banned_users", json::array()},
+      {"whitelist_enabled", false},
+      {"whitelist", json::array()},
+      {"steam_api_key", nullptr},
+    };
+    config.update(overrides);
+    FILE* file = std::fopen((getpath() + "/config.json").c_str(), "w");
+    std::fputs(config.dump().c_str(), file);
+    std::fclose(file);
+
+    int console[2];
+    if (pipe(console) == 0) dup2(console[0], STDIN_FILENO);
+    std::cout.rdbuf(nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    port = freePort();
+    server_t server = new Server(port);
+    std::thread([server]() { server->run(); }).detach();
+    return server;
+  }
+
+  // Polls until the condition holds or the timeout passes
+  template <typename F>
+  inline bool waitFor(F condition, int timeoutMs = 5000)
+  {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (!condition()) {
+      if (std::chrono::steady_clock::now() > deadline) return false;
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+  }
+
+  inline size_t clientCount(server_t server)
+  {
+    server->lock();
+    size_t count = server->getClients().size();
+    server->unlock();
+    return count;
+  }
+
+  // A game client speaking newline-delimited JSON over a blocking socket, optionally through TLS
+  class Connection {
+    public:
+      Connection(int port, bool tls = false, int receiveBuffer = 0) : ssl(nullptr), ctx(nullptr)
+      {
+        this->fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (receiveBuffer > 0) setsockopt(this->fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        this->connected = connect(this->fd, (struct sockaddr*) &addr, sizeof(addr)) == 0;
+        if (!this->connected || !tls) return;
+        this->ctx = SSL_CTX_new(TLS_client_method());
+        this->ssl = SSL_new(this->ctx);
+        SSL_set_fd(this->ssl, this->fd);
+        this->connected = SSL_connect(this->ssl) == 1;
+      };
+
+      ~Connection()
+      {
+        this->close();
+      };
+
+      bool isConnected()
+      {
+        return this->connected;
+      };
+
+      void close()
+      {
+        if (this->ssl) SSL_free(this->ssl);
+        if (this->ctx) SSL_CTX_free(this->ctx);
+        if (this->fd >= 0) ::close(this->fd);
+        this->ssl = nullptr;
+        this->ctx = nullptr;
+        this->fd = -1;
+        this->connected = false;
+      };
+
+      bool sendRaw(const string& data)
+      {
+        size_t sent = 0;
+        while (sent < data.size()) {
+          ssize_t n = this->ssl ? SSL_write(this->ssl, data.data() + sent, data.size() - sent) : ::send(this->fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+          if (n <= 0) return false;
+          sent += n;
+        }
+        return true;
+      };
+
+      bool send(const json& req)
+      {
+        return this->sendRaw(req.dump() + "\n");
+      };
+
+      // Reads the next message. Returns false on timeout, disconnect or a line that is not JSON
+      bool receive(json& res, int timeoutMs = 3000)
+      {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        size_t end;
+        while ((end = this->buffer.find('\n')) == string::npos) {
+          if (!this->ssl || SSL_pending(this->ssl) == 0) {
+            int left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            struct pollfd pfd = {this->fd, POLLIN, 0};
+            if (left <= 0 || poll(&pfd, 1, left) <= 0) return false;
+          }
+          char chunk[65536];
+          ssize_t n = this->ssl ? SSL_read(this->ssl, chunk, sizeof(chunk)) : ::recv(this->fd, chunk, sizeof(chunk), 0);
+          if (n <= 0) return false;
+          this->buffer.append(chunk, n);
+        }
+        string line = this->buffer.substr(0, end);
+        this->buffer.erase(0, end + 1);
+        res = json::parse(line, nullptr, false);
+        return !res.is_discarded();
+      };
+
+      // Reads messages until one for the command arrives, skipping the rest
+      bool expect(const string& cmd, json& res, int timeoutMs = 3000)
+      {
+        while (this->receive(res, timeoutMs)) {
+          if (res["cmd"] == cmd) return true;
+        }
+        return false;
+      };
+
+      bool expect(const string& cmd, int timeoutMs = 3000)
+      {
+        json res;
+        return this->expect(cmd, res, timeoutMs);
+      };
+
+      int getFd()
+      {
+        return this->fd;
+      };
+    private:
+      int fd;
+      bool connected;
+      SSL *ssl;
+      SSL_CTX *ctx;
+      string buffer;
+  };
+
+  inline json joinRequest(steamid_t steamId, const char* cmd = "JOIN")
+  {
+    json req;
+    req["cmd"] = cmd;
+    req["steam_id"] = std::to_string(steamId);
+    req["unlock_hash"] = string(64, 'A');
+    req["stakes"] = {{"b_red", 8}};
+    return req;
+  }
+
+  inline json startRequest(bool versus = false)
+  {
+    json req;
+    req["cmd"] = "START";
+    req["seed"] = "ABCDEFGH";
+    req["deck"] = "b_red";
+    req["stake"] = 1;
+    req["versus"] = versus;
+    req["speed"] = 4;
+    if (versus) req["showdown_ante"] = 2;
+    return req;
+  }
+}
+
+#endif
@@ -0,0 +1,126 @@
+#include <atomic>
+#include "test.hpp"
+
+#define SWAPS 20
+#define JOKERS 100
+#define RECEIVE_BUFFER 4096
+#define FLOOD_MESSAGES 20000
+#define FLOOD_RATIO 10
+#define FLOOD_HIGH_WATER 65536
+
+using namespace balatrogether;
+
+// A joker hand of about 50 KB that can be told apart from any other
+static json jokers(const string& owner, int swap)
+{
+  json list = json::array();
+  for (int i = 0; i < JOKERS; i++) {
+    json joker;
+    joker["k"] = "j_joker";
+    joker["owner"] = owner;
+    joker["swap"] = swap;
+    joker["index"] = i;
+    joker["pad"] = string(480, 'a' + (swap + i) % 26);
+    list.push_back(joker);
+  }
+  return list;
+}
+
+// Connects two players with small receive buffers and starts a run
+static void start(int port, test::Connection& a, test::Connection& b, bool versus)
+{
+  CHECK(a.isConnected() && b.isConnected());
+  CHECK(a.send(test::joinRequest(76561198000000001)) && a.expect("JOIN"));
+  CHECK(b.send(test::joinRequest(76561198000000002)) && b.expect("JOIN") && a.expect("JOIN"));
+  CHECK(a.send(test::startRequest(versus)) && a.expect("START") && b.expect("START"));
+}
+
+// Large replies are queued for players that are not reading, with receive buffers so small that every TLS record
+// is written in pieces. Each player must then read every reply whole and in order
+static void swaps()
+{
+  int port;
+  test::startServer({{"tls_enabled", true}, {"send_high_water", 64 * 1048576}}, port);
+  test::Connection a(port, true, RECEIVE_BUFFER);
+  test::Connection b(port, true, RECEIVE_BUFFER);
+  start(port, a, b, true);
+
+  for (int swap = 0; swap < SWAPS; swap++) {
+    json req;
+    req["cmd"] = "SWAP_JOKERS";
+    req["jokers"] = jokers("a", swap);
+    CHECK(a.send(req));
+  }
+
+  std::vector<string> requestIds;
+  for (int swap = 0; swap < SWAPS; swap++) {
+    json res;
+    CHECK(b.expect("SWAP_JOKERS", res));
+    CHECK(res["data"]["jokers"] == jokers("a", swap));
+    requestIds.push_back(res["data"]["request_id"].is_string() ? res["data"]["request_id"].get<string>() : "");
+  }
+
+  for (int swap = 0; swap < SWAPS; swap++) {
+    json req;
+    req["cmd"] = "SWAP_JOKERS";
+    req["request_id"] = requestIds[swap];
+    req["jokers"] = jokers("b", swap);
+    CHECK(b.send(req));
+  }
+  for (int swap = 0; swap < SWAPS; swap++) {
+    json res;
+    CHECK(a.expect("SWAP_JOKERS", res));
+    CHECK(res["data"]["jokers"] == jokers("b", swap));
+  }
+}
+
+// A slow reader is sent cosmetic messages past the high water mark, so queued ones are purged while TLS writes are
+// waiting to be retried. Every line must still parse, and no other message may be lost or reordered
+static void flood()
+{
+  int port;
+  test::startServer({{"tls_enabled", true}, {"send_high_water", FLOOD_HIGH_WATER}}, port);
+  test::Connection a(port, true);
+  test::Connection b(port, true, RECEIVE_BUFFER);
+  start(port, a, b, false);
+
+  std::atomic<int> highlights(0), reorders(0), broken(0);
+  std::thread reader([&]() {
+    json res;
+    int lines = 0;
+    while (reorders < FLOOD_MESSAGES / FLOOD_RATIO) {
+      if (!b.receive(res)) {
+        broken++;
+        return;
+      }
+      if (res["cmd"] == "HIGHLIGHT") highlights++;
+      if (res["cmd"] == "REORDER" && res["data"]["from"] != reorders++) broken++;
+      if (++lines % 20 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+
+  for (int i = 0; i < FLOOD_MESSAGES; i++) {
+    json req;
+    req["type"] = "hand";
+    if (i % FLOOD_RATIO == FLOOD_RATIO - 1) {
+      req["cmd"] = "REORDER";
+      req["from"] = i / FLOOD_RATIO;
+      req["to"] = 0;
+    } else {
+      req["cmd"] = "HIGHLIGHT";
+      req["index"] = i;
+    }
+    CHECK(a.send(req));
+  }
+  reader.join();
+  CHECK(broken == 0);
+  CHECK(reorders == FLOOD_MESSAGES / FLOOD_RATIO);
+  CHECK(highlights < FLOOD_MESSAGES - FLOOD_MESSAGES / FLOOD_RATIO);
+}
+
+int main()
+{
+  swaps();
+  flood();
+  test::finish();
+}
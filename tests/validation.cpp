@@ -0,0 +1,209 @@
+#include <climits>
+#include <random>
+#include <regex>
+#include "test.hpp"
+#include "util/request.hpp"
+#include "util/validation.hpp"
+#include "network.hpp"
+
+using namespace balatrogether;
+
+// The validators as they were before they stopped using regexes and number parsing, kept to compare against
+namespace reference {
+  static const std::regex base64_expr("^(?:[A-Za-z0-9+/]{4})*(?:[A-Za-z0-9+/]{2}==|[A-Za-z0-9+/]{3}=)?$");
+
+  static bool base64(json& data)
+  {
+    if (!data.is_string()) return false;
+    return std::regex_search(data.get<string>(), base64_expr);
+  }
+
+  static bool steamid(json& data)
+  {
+    if (!data.is_string() || data.get<string>().size() > 32) return false;
+    string str = data.get<string>();
+    uint64_t num = strtoull(str.c_str(), nullptr, 10);
+    return std::to_string(num) == str;
+  }
+}
+
+static int base64Mismatches = 0;
+static int steamidMismatches = 0;
+
+static void compareBase64(const string& str)
+{
+  json data = str;
+  if (validation::base64(data) != reference::base64(data)) {
+    if (base64Mismatches++ < 10) std::fprintf(stderr, "base64 differs for \"%s\"\n", str.c_str());
+  }
+}
+
+static void compareSteamId(const string& str)
+{
+  json data = str;
+  if (validation::steamid(data) != reference::steamid(data)) {
+    if (steamidMismatches++ < 10) std::fprintf(stderr, "steamid differs for \"%s\"\n", str.c_str());
+  }
+}
+
+// Every string of up to six characters from an alphabet with each kind of character that matters
+static void exhaustiveBase64()
+{
+  const string alphabet = "Az9+/=-\n";
+  for (size_t length = 0; length <= 6; length++) {
+    size_t total = 1;
+    for (size_t i = 0; i < length; i++) total *= alphabet.size();
+    for (size_t n = 0; n < total; n++) {
+      string str;
+      for (size_t i = 0, rest = n; i < length; i++, rest /= alphabet.size()) str += alphabet[rest % alphabet.size()];
+      compareBase64(str);
+    }
+  }
+}
+
+// Unlock hashes of realistic length, valid and with one character changed
+static void randomBase64()
+{
+  const string chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  const string noise("=-_ .\n\0\xff", 8);
+  std::mt19937 random(1);
+  for (int i = 0; i < 20000; i++) {
+    size_t length = random() % 132;
+    string str;
+    for (size_t j = 0; j < length; j++) str += chars[random() % chars.size()];
+    int padding = random() % 3;
+    for (int j = 0; j < padding && j < (int) length; j++) str[length - 1 - j] = '=';
+    if (random() % 2 && length > 0) str[random() % length] = noise[random() % noise.size()];
+    compareBase64(str);
+  }
+}
+
+static void steamIds()
+{
+  const char* cases[] = {
+    "", "0", "00", "01", "1", "+1", "-1", " 1", "1 ", "1a", "a1", "0x10",
+    "76561198000000000", "076561198000000000", "76561198000000000\n",
+    "18446744073709551615", "18446744073709551616", "99999999999999999999", "184467440737095516150",
+    "000000000000000000000000000000001", "100000000000000000000000000000000",
+  };
+  for (const char* str : cases) compareSteamId(str);
+
+  std::mt19937_64 random(1);
+  for (int i = 0; i < 20000; i++) {
+    compareSteamId(std::to_string(random() >> (random() % 64)));
+    string digits;
+    size_t length = 1 + random() % 34;
+    for (size_t j = 0; j < length; j++) digits += '0' + random() % 10;
+    compareSteamId(digits);
+  }
+
+  json number = 76561198000000000;
+  CHECK(!validation::steamid(number) && !reference::steamid(number));
+}
+
+static void lengths()
+{
+  json data = string(64, 'A');
+  CHECK(validation::string(data, 64, 128));
+  CHECK(!validation::string(data, 65, 128));
+  CHECK(!validation::string(data, 0, 63));
+  CHECK(validation::string(data, 64));
+  json empty = "";
+  CHECK(validation::string(empty, 0, 0));
+  CHECK(!validation::string(empty, 1, 8));
+  json number = 1;
+  CHECK(!validation::string(number, 0, 8));
+}
+
+// A request for the command, padded to exactly the given length
+static string padded(const string& cmd, size_t length)
+{
+  string head = "{\"cmd\":\"" + cmd + "\",\"pad\":\"";
+  return head + string(length - head.size() - 2, 'x') + "\"}";
+}
+
+// A request for the command nested to the given depth, counting the request itself
+static string nested(const string& cmd, size_t depth)
+{
+  return "{\"cmd\":\"" + cmd + "\",\"a\":" + string(depth - 1, '[') + string(depth - 1, ']') + "}";
+}
+
+static string list(size_t count)
+{
+  string items;
+  for (size_t i = 0; i < count; i++) items += i == 0 ? "0" : ",0";
+  return "[" + items + "]";
+}
+
+// A request for the command holding an array with the given number of elements
+static string elements(const string& cmd, size_t count)
+{
+  return "{\"cmd\":\"" + cmd + "\",\"a\":" + list(count) + "}";
+}
+
+static request::parse_status_t parse(const string& data)
+{
+  json result;
+  return request::parse(data.data(), data.size(), result);
+}
+
+// Each command's limits are reached exactly, and broken by one more byte, level or element
+static void limits()
+{
+  const request::limits& defaults = request::getLimits("HIGHLIGHT");
+  CHECK(defaults.bytes == REQUEST_MAX_BYTES && defaults.depth == REQUEST_MAX_DEPTH && defaults.elements == REQUEST_MAX_ELEMENTS);
+  for (string cmd : {"HIGHLIGHT", "SWAP_JOKERS", "GET_CARDS_AND_JOKERS"}) {
+    const request::limits& l = request::getLimits(cmd);
+    CHECK(parse(padded(cmd, l.bytes)) == request::PARSE_OK);
+    CHECK(parse(padded(cmd, l.bytes + 1)) == request::PARSE_TOO_LARGE);
+    CHECK(parse(nested(cmd, l.depth)) == request::PARSE_OK);
+    CHECK(parse(nested(cmd, l.depth + 1)) == request::PARSE_TOO_LARGE);
+    CHECK(parse(elements(cmd, l.elements)) == request::PARSE_OK);
+    CHECK(parse(elements(cmd, l.elements + 1)) == request::PARSE_TOO_LARGE);
+  }
+
+  string late = "{\"a\":" + list(REQUEST_MAX_ELEMENTS + 1) + ",\"cmd\":";
+  CHECK(parse(late + "\"SWAP_JOKERS\"}") == request::PARSE_OK);
+  CHECK(parse(late + "\"HIGHLIGHT\"}") == request::PARSE_TOO_LARGE);
+
+  CHECK(parse(string(200000, '[')) == request::PARSE_TOO_LARGE);
+  CHECK(parse("{\"cmd\":\"GET_CARDS_AND_JOKERS\",\"a\":" + string(200000, '[')) == request::PARSE_TOO_LARGE);
+  CHECK(parse(string(300000, ' ')) == request::PARSE_TOO_LARGE);
+  CHECK(parse("{\"cmd\":") == request::PARSE_INVALID);
+  CHECK(parse("") == request::PARSE_INVALID);
+}
+
+// Requests over their limits are answered with an error and the player stays connected. Only a line longer than
+// MAX_MESSAGE_SIZE closes the connection, and the server keeps accepting players
+static void oversize()
+{
+  int port;
+  server_t server = test::startServer(json::object(), port);
+  test::Connection a(port);
+  json res;
+  CHECK(a.sendRaw(nested("JOIN", REQUEST_MAX_DEPTH + 1) + "\n") && a.receive(res) && res["success"] == false);
+  CHECK(a.send(test::joinRequest(76561198000000001)) && a.expect("JOIN"));
+  CHECK(a.sendRaw(elements("HIGHLIGHT", REQUEST_MAX_ELEMENTS + 1) + "\n") && a.receive(res) && res["success"] == false);
+  CHECK(a.sendRaw(padded("SWAP_JOKERS", request::getLimits("SWAP_JOKERS").bytes + 1) + "\n") && a.receive(res) && res["success"] == false);
+  CHECK(a.sendRaw(nested("SWAP_JOKERS", 1000) + "\n") && a.receive(res) && res["success"] == false);
+  CHECK(test::clientCount(server) == 1);
+
+  a.sendRaw(string(MAX_MESSAGE_SIZE, '['));
+  CHECK(!a.receive(res));
+  CHECK(test::waitFor([server]() { return test::clientCount(server) == 0; }));
+  test::Connection b(port);
+  CHECK(b.send(test::joinRequest(76561198000000002)) && b.expect("JOIN"));
+}
+
+int main()
+{
+  exhaustiveBase64();
+  randomBase64();
+  steamIds();
+  lengths();
+  limits();
+  oversize();
+  CHECK(base64Mismatches == 0);
+  CHECK(steamidMismatches == 0);
+  test::finish();
+}